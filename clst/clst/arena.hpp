@@ -8,8 +8,8 @@ namespace clst {
 
 class Arena {
 public:
-    Arena(void* begin, std::ptrdiff_t length): cur_(static_cast<unsigned char*>(begin)), end_(cur_ + length) {}
-    Arena(void* begin, void* end): cur_(static_cast<unsigned char*>(begin)), end_(static_cast<unsigned char*>(end)) {}
+    Arena(void* begin, std::ptrdiff_t length): beg_(static_cast<unsigned char*>(begin)), cur_(beg_), end_(cur_ + length) {}
+    Arena(void* begin, void* end): beg_(static_cast<unsigned char*>(begin)), cur_(beg_), end_(static_cast<unsigned char*>(end)) {}
 
     // Not copy-able or move-able
     Arena(const Arena&) = delete;
@@ -37,11 +37,29 @@ public:
     {
         return end_ - cur_;
     }
+
+    // Current allocation position, to be passed to reset() later.
+    void* top() const noexcept
+    {
+        return cur_;
+    }
+
+    // Free everything allocated after `top` was taken.
+    void reset(void* top) noexcept
+    {
+        cur_ = static_cast<unsigned char*>(top);
+    }
+
+    // Free everything.
+    void reset() noexcept
+    {
+        cur_ = beg_;
+    }
     
     //void* align(std::ptrdiff_t alignment) noexcept;
 
 private:
-    //unsigned char* beg_;
+    unsigned char* beg_;
     unsigned char* cur_;
     unsigned char* end_;
 };
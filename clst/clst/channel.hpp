@@ -1,36 +1,166 @@
 #ifndef CLST_CHANNEL_HPP
 #define CLST_CHANNEL_HPP
 
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <deque>
+#include <iterator>
 #include <mutex>
-#include <condition_variable>
 #include <optional>
 #include <cassert>
 #include <type_traits>
+#include <utility>
+#include <vector>
+#include "clst/ring_buffer.hpp"
+#include "clst/scope_guard.hpp"
+#include "clst/stop_token.hpp"
+#include "clst/wait_policy.hpp"
+#include "clst/detail/cache_line.hpp"
+#include "clst/detail/mpmc_ring.hpp"
+#include "clst/detail/mpsc_queue.hpp"
+#include "clst/detail/spsc_ring.hpp"
 
 namespace clst {
 
 namespace detail {
 
-template<bool Bounded>
+template<bool Bounded, class WaitPolicy>
 struct ChannelSize {};
 
-template<>
-struct ChannelSize<true> {
-    std::size_t max_;
-    std::condition_variable cond_emplace_;
+// The capacity is kept by the RingBuffer.
+template<class WaitPolicy>
+struct ChannelSize<true, WaitPolicy> {
+    WaitEvent<WaitPolicy> cond_emplace_;
+};
+
+// Suspended coroutine waiting on a Channel, see clst/coro.hpp.
+// Woken up once its operation went through (`done`), or the channel was closed.
+struct ChannelWaiter {
+    ChannelWaiter* next = nullptr;
+    bool           done = false;
+    void (*wake)(ChannelWaiter*) noexcept = nullptr;
+};
 
-    ChannelSize(std::size_t max) : max_(max) {}
+template<class T>
+struct ChannelPopWaiter : ChannelWaiter {
+    std::optional<T> value;
 };
 
+template<class T>
+struct ChannelEmplaceWaiter : ChannelWaiter {
+    T* value = nullptr;
+};
+
+template<typename ...Ts>
+struct StartsWithStopToken : std::false_type {};
+
+template<typename T, typename ...Ts>
+struct StartsWithStopToken<T, Ts...> : std::is_same<std::decay_t<T>, StopToken> {};
+
+// How long a channel operation may block: Until it can go through, not at all, or until a std::chrono::time_point.
+struct WaitForever {};
+struct NoWait {};
+
+// Wait for `pred` under `lk`, as long as `deadline` allows. Returns the last result of `pred()`.
+template<class Policy, typename Deadline, typename Pred>
+bool
+channel_wait(WaitEvent<Policy>& event, std::unique_lock<std::mutex>& lk, const Deadline& deadline, Pred pred)
+{
+    if constexpr (std::is_same_v<Deadline, WaitForever>) {
+        event.wait(lk, pred);
+        return true;
+    } else if constexpr (std::is_same_v<Deadline, NoWait>) {
+        return pred();
+    } else {
+        return event.wait_until(lk, deadline, pred);
+    }
+}
+
+// Lock-free counterpart, see EventCount.
+template<class Policy, typename Deadline, typename Pred>
+bool
+channel_wait(EventCount<Policy>& event, const Deadline& deadline, Pred&& ready)
+{
+    if constexpr (std::is_same_v<Deadline, WaitForever>) {
+        event.wait(ready);
+        return true;
+    } else if constexpr (std::is_same_v<Deadline, NoWait>) {
+        return ready();
+    } else {
+        return event.wait_until(deadline, ready);
+    }
 }
 
-//FIXME: Use a ring buffer when bounded.
+// FIFO of waiters, guarded by the channel mutex.
+class ChannelWaiterList {
+public:
+    bool empty() const noexcept
+    {
+        return head_ == nullptr;
+    }
+
+    void push(ChannelWaiter* w) noexcept
+    {
+        w->next = nullptr;
+        if (tail_) {
+            tail_->next = w;
+        } else {
+            head_ = w;
+        }
+        tail_ = w;
+    }
+
+    ChannelWaiter* front() const noexcept
+    {
+        return head_;
+    }
+
+    ChannelWaiter* pop() noexcept
+    {
+        auto* const w = head_;
+        if (w) {
+            head_ = w->next;
+            if (!head_) tail_ = nullptr;
+        }
+        return w;
+    }
+
+    // Take the whole list, to be woken up with wake_all() outside the lock.
+    ChannelWaiter* take_all() noexcept
+    {
+        tail_ = nullptr;
+        return std::exchange(head_, nullptr);
+    }
+
+    static void wake_all(ChannelWaiter* w) noexcept
+    {
+        while (w) {
+            auto* const next = w->next; // w is gone once woken up
+            w->wake(w);
+            w = next;
+        }
+    }
+
+private:
+    ChannelWaiter* head_ = nullptr;
+    ChannelWaiter* tail_ = nullptr;
+};
+
+}
 
-template<class T, bool Bounded = true, bool Sp = false, bool Sc = false>
-class Channel : protected std::deque<T>, protected detail::ChannelSize<Bounded> {
+// WaitPolicy decides how blocked producers and consumers wait, see clst/wait_policy.hpp.
+// Bounded SPSC and MPMC channels, and unbounded single-consumer channels are lock-free, see the specializations below.
+// The others go through a mutex. Bounded ones keep their items in a RingBuffer, allocated once, unbounded ones in a deque.
+// The lock-free backends need a nothrow move-constructible T; other types get the mutex one. That's all `LockFree`
+// is for: Leave it defaulted.
+template<class T, bool Bounded = true, bool Sp = false, bool Sc = false, class WaitPolicy = BlockingWait,
+         bool LockFree = std::is_nothrow_move_constructible_v<T>>
+class Channel : protected std::conditional_t<Bounded, RingBuffer<T>, std::deque<T>>,
+                protected detail::ChannelSize<Bounded, WaitPolicy> {
 public:
-    using Container = std::deque<T>;
+    using Container = std::conditional_t<Bounded, RingBuffer<T>, std::deque<T>>;
     using typename Container::value_type;
     using typename Container::size_type;
     using typename Container::reference;
@@ -41,11 +171,62 @@ public:
     static constexpr bool is_single_consumer = Sc;
 private:
     std::mutex mtx_;
-    std::condition_variable cond_pop_;
+    detail::WaitEvent<WaitPolicy> cond_pop_;
     bool closed_ = false;
+    // Coroutines, see clst/coro.hpp. Consumers only wait on an empty channel, producers on a full one.
+    detail::ChannelWaiterList pop_waiters_;
+    detail::ChannelWaiterList emplace_waiters_;
+
+    // Hand the item over to a suspended consumer, if any.
+    template<typename ...Ts>
+    detail::ChannelWaiter* hand_over(Ts&& ...Args)
+    {
+        auto* const w = pop_waiters_.pop();
+        if (w) {
+            static_cast<detail::ChannelPopWaiter<T>*>(w)->value.emplace(std::forward<Ts>(Args)...);
+            w->done = true;
+        }
+        return w;
+    }
+
+    // Append an item. A bounded channel has checked for room already.
+    template<typename ...Ts>
+    void push_item(Ts&& ...Args)
+    {
+        if constexpr (Bounded) {
+            Container::emplace(std::forward<Ts>(Args)...);
+        } else {
+            Container::emplace_back(std::forward<Ts>(Args)...);
+        }
+    }
+
+    void pop_item() noexcept
+    {
+        if constexpr (Bounded) {
+            Container::pop();
+        } else {
+            Container::pop_front();
+        }
+    }
+
+    // After a pop, fill the free slot from a suspended producer, if any.
+    detail::ChannelWaiter* refill()
+    {
+        if constexpr (Bounded) {
+            auto* const w = emplace_waiters_.pop();
+            if (w) {
+                push_item(std::move(*static_cast<detail::ChannelEmplaceWaiter<T>*>(w)->value));
+                w->done = true;
+            }
+            return w;
+        } else {
+            return nullptr;
+        }
+    }
 public:
     template<bool B = Bounded, typename = std::enable_if_t<B>> // Unnecessary?
-    Channel(size_type max_items) : detail::ChannelSize<Bounded>{(assert(max_items > 0), max_items)} {};
+    Channel(size_type max_items)
+    : Container((assert(max_items > 0), max_items)) {}
 
     Channel() = default; // default = Implicitly deleted, if Bounded.
 
@@ -62,152 +243,908 @@ public:
         return Container::size();
     }
 
-    template<typename ...Ts>
+    template<typename ...Ts, typename = std::enable_if_t<!detail::StartsWithStopToken<Ts...>::value>>
     bool emplace(Ts&& ...Args)
     {
-        using Lock = std::conditional_t<Bounded, std::unique_lock<decltype(mtx_)>, std::lock_guard<decltype(mtx_)>>;
-        if constexpr (Sc) {
-            bool should_notify; // For single-consumer, we only need to notify the consumer when filling an empty queue.
-            {
-                Lock lk(mtx_);
-                if constexpr (Bounded) {
-                    this->cond_emplace_.wait(lk, [&] { return Container::size() < this->max_ || closed_; });
-                }
-                if (closed_) {
-                    return false;
-                }
-                should_notify = Container::empty();
-                Container::emplace_back(std::forward<Ts>(Args)...);
+        return emplace_with(nullptr, detail::WaitForever{}, std::forward<Ts>(Args)...);
+    }
+
+    /**
+     * As emplace(), but give up once `token` is signalled.
+     * Returns false if the channel is closed, or the token was signalled before there was room.
+     */
+    template<typename ...Ts>
+    bool emplace(const StopToken& token, Ts&& ...Args)
+    {
+        return emplace_with(&token, detail::WaitForever{}, std::forward<Ts>(Args)...);
+    }
+
+    // As emplace(), but don't block. Returns false if the channel is full, or closed.
+    template<typename ...Ts>
+    bool try_emplace(Ts&& ...Args)
+    {
+        return emplace_with(nullptr, detail::NoWait{}, std::forward<Ts>(Args)...);
+    }
+
+    void close()
+    {
+        detail::ChannelWaiter* consumers;
+        detail::ChannelWaiter* producers;
+        {
+            std::lock_guard lk(mtx_);
+            closed_ = true;
+            consumers = pop_waiters_.take_all();
+            producers = emplace_waiters_.take_all();
+        }
+        detail::ChannelWaiterList::wake_all(consumers);
+        detail::ChannelWaiterList::wake_all(producers);
+        cond_pop_.notify_all();
+        if constexpr (Bounded) {
+            this->cond_emplace_.notify_all();
+        }
+    }
+
+    bool pop(value_type& dst) // pop to destination
+    {
+        return pop_with([&](value_type& item) { dst = std::move(item); });
+    }
+
+    std::optional<value_type> pop()
+    {
+        std::optional<value_type> ret;
+        pop_with([&](value_type& item) { ret = std::move(item); });
+        return ret;
+    }
+
+    /**
+     * As pop(), but give up once `token` is signalled. Items are left in the channel then.
+     * Returns false if the channel is closed and empty, or the token was signalled.
+     */
+    bool pop(const StopToken& token, value_type& dst)
+    {
+        return pop_with([&](value_type& item) { dst = std::move(item); }, &token);
+    }
+
+    std::optional<value_type> pop(const StopToken& token)
+    {
+        std::optional<value_type> ret;
+        pop_with([&](value_type& item) { ret = std::move(item); }, &token);
+        return ret;
+    }
+
+    // As pop(), but don't block. Returns false if the channel is empty.
+    bool try_pop(value_type& dst)
+    {
+        return pop_with([&](value_type& item) { dst = std::move(item); }, nullptr, detail::NoWait{});
+    }
+
+    std::optional<value_type> try_pop()
+    {
+        std::optional<value_type> ret;
+        pop_with([&](value_type& item) { ret = std::move(item); }, nullptr, detail::NoWait{});
+        return ret;
+    }
+
+    /**
+     * As pop(), but give up at `deadline`.
+     * Returns false if the channel is closed and empty, or still empty by then.
+     */
+    template<class Clock, class Duration>
+    bool pop_until(const std::chrono::time_point<Clock, Duration>& deadline, value_type& dst)
+    {
+        return pop_with([&](value_type& item) { dst = std::move(item); }, nullptr, deadline);
+    }
+
+    template<class Clock, class Duration>
+    std::optional<value_type> pop_until(const std::chrono::time_point<Clock, Duration>& deadline)
+    {
+        std::optional<value_type> ret;
+        pop_with([&](value_type& item) { ret = std::move(item); }, nullptr, deadline);
+        return ret;
+    }
+
+    // As pop_until(), `timeout` from now.
+    template<class Rep, class Period>
+    bool pop_for(const std::chrono::duration<Rep, Period>& timeout, value_type& dst)
+    {
+        return pop_until(std::chrono::steady_clock::now() + timeout, dst);
+    }
+
+    template<class Rep, class Period>
+    std::optional<value_type> pop_for(const std::chrono::duration<Rep, Period>& timeout)
+    {
+        return pop_until(std::chrono::steady_clock::now() + timeout);
+    }
+
+    /**
+     * Move up to `max_n` items to `out`, in one go. Blocks until there's at least one item, as pop() does.
+     * Returns how many were moved, 0 once the channel is closed and empty.
+     *
+     * Producers are woken up in proportion to the slots freed.
+     */
+    template<class OutputIt>
+    size_type pop_many(OutputIt out, size_type max_n)
+    {
+        if (max_n == 0) return 0;
+        size_type nb_items = 0;
+        size_type nb_freed = 0;
+        bool      was_full = false;
+        detail::ChannelWaiterList refilled;
+        {
+            std::unique_lock lk(mtx_);
+            cond_pop_.wait(lk, [&] { return closed_ || !Container::empty(); });
+            if constexpr (Bounded) {
+                was_full = Container::size() == Container::capacity();
             }
-            if (should_notify) {
-                cond_pop_.notify_one();
+            for (; nb_items < max_n && !Container::empty(); ++nb_items) {
+                *out = std::move(Container::front());
+                ++out;
+                pop_item();
             }
-            return true;
-        } else {
+            nb_freed = nb_items;
+            while (nb_freed != 0) {
+                auto* const w = refill();
+                if (!w) break;
+                refilled.push(w);
+                --nb_freed;
+            }
+        }
+        detail::ChannelWaiterList::wake_all(refilled.take_all());
+        if constexpr (Bounded) {
+            // A single producer only waits on a full channel.
+            if (nb_freed != 0 && (!Sp || was_full)) this->cond_emplace_.notify(Sp ? 1 : nb_freed);
+        }
+        return nb_items;
+    }
+
+    // As pop_many(), appending to `dst`. Reuse `dst` across calls, to keep its capacity.
+    size_type drain_into(std::vector<value_type>& dst, size_type max_n)
+    {
+        return pop_many(std::back_inserter(dst), max_n);
+    }
+
+    /**
+     * Emplace items constructed from `*it`, for each `it` in [first, last). Pass move iterators to move them in.
+     * Takes the lock once for as many items as there's room for, blocking while full.
+     * Returns how many were emplaced. Fewer than the range holds only if the channel got closed.
+     */
+    template<class InputIt>
+    size_type emplace_many(InputIt first, InputIt last)
+    {
+        size_type nb_items = 0;
+        const auto has_room = [&] {
+            if constexpr (Bounded) {
+                return Container::size() < Container::capacity();
+            } else {
+                return true;
+            }
+        };
+        while (first != last) {
+            detail::ChannelWaiterList handed;
+            size_type nb_pushed = 0;
+            bool      was_empty;
             {
-                Lock lk(mtx_);
+                std::unique_lock lk(mtx_);
                 if constexpr (Bounded) {
-                    this->cond_emplace_.wait(lk, [&] { return Container::size() < this->max_ || closed_; });
+                    this->cond_emplace_.wait(lk, [&] { return has_room() || closed_; });
                 }
                 if (closed_) {
-                    return false;
+                    break;
+                }
+                // Suspended consumers only wait on an empty channel: Serve them first.
+                for (; first != last; ++first, ++nb_items) {
+                    auto* const w = hand_over(*first);
+                    if (!w) break;
+                    handed.push(w);
+                }
+                was_empty = Container::empty();
+                for (; first != last && has_room(); ++first, ++nb_items, ++nb_pushed) {
+                    push_item(*first);
                 }
-                Container::emplace_back(std::forward<Ts>(Args)...);
             }
-            cond_pop_.notify_one();
-            return true;
+            detail::ChannelWaiterList::wake_all(handed.take_all());
+            // A single consumer only waits on an empty channel.
+            if (nb_pushed != 0 && (!Sc || was_empty)) cond_pop_.notify(Sc ? 1 : nb_pushed);
         }
+        return nb_items;
     }
 
-    void close()
+    void clear()
     {
+        detail::ChannelWaiterList refilled;
         {
             std::lock_guard lk(mtx_);
-            closed_ = true;
+            Container::clear();
+            if constexpr (Bounded) {
+                while (Container::size() < Container::capacity()) {
+                    auto* const w = refill();
+                    if (!w) break;
+                    refilled.push(w);
+                }
+            }
         }
-        cond_pop_.notify_all();
+        detail::ChannelWaiterList::wake_all(refilled.take_all());
         if constexpr (Bounded) {
             this->cond_emplace_.notify_all();
         }
     }
 
-    bool pop(value_type& dst) // pop to destination
+    // Low-level hooks for the awaitables of clst/coro.hpp.
+
+    // Pop into `w`, or queue it until an item comes in or the channel is closed. Returns false if queued.
+    bool pop_or_wait(detail::ChannelPopWaiter<T>& w)
     {
-        if constexpr (!Bounded || !Sp) {
-            {
-                std::unique_lock lk(mtx_);
-                cond_pop_.wait(lk, [&] { return closed_ || !Container::empty(); });
-                if (Container::empty()) { // continue if closed but not empty
-                    return false;
+        detail::ChannelWaiter* woken = nullptr;
+        bool should_notify = false;
+        {
+            std::lock_guard lk(mtx_);
+            if (Container::empty()) {
+                if (closed_) {
+                    w.done = false;
+                    return true;
                 }
-                dst = std::move(Container::front());
-                Container::pop_front();
+                pop_waiters_.push(&w);
+                return false;
             }
             if constexpr (Bounded) {
-                this->cond_emplace_.notify_one();
+                should_notify = !Sp || Container::size() == Container::capacity();
             }
+            w.value.emplace(std::move(Container::front()));
+            w.done = true;
+            pop_item();
+            woken = refill();
+        }
+        if (woken) {
+            woken->wake(woken);
+        } else if constexpr (Bounded) {
+            if (should_notify) this->cond_emplace_.notify_one();
+        }
+        return true;
+    }
+
+    // Emplace `*w.value`, or queue `w` until there's room or the channel is closed. Returns false if queued.
+    bool emplace_or_wait(detail::ChannelEmplaceWaiter<T>& w)
+    {
+        detail::ChannelWaiter* woken;
+        {
+            std::lock_guard lk(mtx_);
+            if (closed_) {
+                w.done = false;
+                return true;
+            }
+            woken = hand_over(std::move(*w.value));
+            if (!woken) {
+                if constexpr (Bounded) {
+                    if (Container::size() >= Container::capacity()) {
+                        emplace_waiters_.push(&w);
+                        return false;
+                    }
+                }
+                push_item(std::move(*w.value));
+            }
+            w.done = true;
+        }
+        if (woken) {
+            woken->wake(woken);
         } else {
-            bool should_notify; // For single-producer, we only need to notify the producer when taking from a full queue (Bounded).
+            cond_pop_.notify_one();
+        }
+        return true;
+    }
+
+private:
+    // Wakes up the threads blocked on an event, so that they see the stop request.
+    // Going through the lock means that no waiter can miss it between checking its token and parking.
+    struct StopWaker {
+        Channel*                        ch;
+        detail::WaitEvent<WaitPolicy>*  event;
+
+        void operator()() noexcept
+        {
             {
-                std::unique_lock lk(mtx_);
-                cond_pop_.wait(lk, [&] { return closed_ || !Container::empty(); });
-                if (Container::empty()) { // continue if closed but not empty
+                std::lock_guard lk(ch->mtx_);
+            }
+            event->notify_all();
+        }
+    };
+
+    // Registered outside the lock: The callback takes it, and may run inline or be waited for on destruction.
+    using StopWakeUp = std::optional<StopCallback<StopWaker>>;
+
+    template<typename Deadline, typename ...Ts>
+    bool emplace_with(const StopToken* token, const Deadline& deadline, Ts&& ...Args)
+    {
+        using Lock = std::conditional_t<Bounded, std::unique_lock<decltype(mtx_)>, std::lock_guard<decltype(mtx_)>>;
+        const auto stopped = [&] { return token && token->stop_requested(); };
+        StopWakeUp wake_up;
+        if constexpr (Bounded) {
+            if (token && token->stop_possible()) wake_up.emplace(*token, StopWaker{this, &this->cond_emplace_});
+        }
+        bool should_notify = true; // For single-consumer, we only need to notify the consumer when filling an empty queue.
+        detail::ChannelWaiter* woken;
+        {
+            Lock lk(mtx_);
+            if constexpr (Bounded) {
+                const bool ready = detail::channel_wait(this->cond_emplace_, lk, deadline, [&] {
+                    return Container::size() < Container::capacity() || closed_ || stopped();
+                });
+                if (!ready) {
                     return false;
                 }
-                should_notify = Container::size() == this->max_;
-                dst = std::move(Container::front());
-                Container::pop_front();
             }
-            if (should_notify) {
-                this->cond_emplace_.notify_one();
+            if (closed_ || stopped()) {
+                return false;
+            }
+            woken = hand_over(std::forward<Ts>(Args)...);
+            if constexpr (Sc) {
+                should_notify = !woken && Container::empty();
             }
+            if (!woken) {
+                push_item(std::forward<Ts>(Args)...);
+            }
+        }
+        if (woken) {
+            woken->wake(woken);
+        } else if (should_notify) {
+            cond_pop_.notify_one();
         }
+        return true;
+    }
 
+    template<typename F, typename Deadline = detail::WaitForever>
+    bool pop_with(F&& take, const StopToken* token = nullptr, const Deadline& deadline = {})
+    {
+        const auto stopped = [&] { return token && token->stop_requested(); };
+        StopWakeUp wake_up;
+        if (token && token->stop_possible()) wake_up.emplace(*token, StopWaker{this, &cond_pop_});
+        bool should_notify = false; // For single-producer, we only need to notify the producer when taking from a full queue (Bounded).
+        detail::ChannelWaiter* woken;
+        {
+            std::unique_lock lk(mtx_);
+            detail::channel_wait(cond_pop_, lk, deadline, [&] { return closed_ || !Container::empty() || stopped(); });
+            if (Container::empty() || stopped()) { // continue if closed but not empty, or timed out
+                return false;
+            }
+            if constexpr (Bounded) {
+                should_notify = !Sp || Container::size() == Container::capacity();
+            }
+            take(Container::front());
+            pop_item();
+            woken = refill();
+        }
+        if (woken) {
+            woken->wake(woken);
+        } else if constexpr (Bounded) {
+            if (should_notify) this->cond_emplace_.notify_one();
+        }
         return true;
     }
+};
+
+namespace detail {
+
+/**
+ * Blocking frontend over a lock-free queue, shared by the lock-free Channel specializations.
+ *
+ * Queue provides try_emplace(args...) (false if full, leaving the arguments alone; it may throw before publishing
+ * anything), try_consume(take) (false if empty) and an approximate size(). Threads only park on the edges, on an
+ * EventCount each: Consumers when the channel is empty, producers when it is full. Suspended coroutines (see
+ * clst/coro.hpp) are queued under a mutex, which is only taken while some are waiting. They're served by the thread
+ * that makes their operation possible, which then stands in for the suspended producer or consumer.
+ *
+ * close() can race with emplace(). Producers count themselves in `pushing_` around a push, and consumers only
+ * report a closed channel once no push is in flight and it is drained.
+ *
+ * A push can't be undone, so T must be nothrow move-constructible. Items that can't be constructed in place without
+ * throwing are constructed first, then moved in.
+ */
+template<class T, class Queue, bool Bounded, bool Sp, bool Sc, class WaitPolicy>
+class LockFreeChannel {
+    static_assert(std::is_nothrow_move_constructible_v<T>, "Lock-free channels require a nothrow move-constructible T");
+
+public:
+    using value_type      = T;
+    using size_type       = std::size_t;
+    using reference       = T&;
+    using const_reference = const T&;
+
+    static constexpr bool is_bounded = Bounded;
+    static constexpr bool is_single_producer = Sp;
+    static constexpr bool is_single_consumer = Sc;
+
+    // Not copiable or movable.
+    LockFreeChannel(const LockFreeChannel&) = delete;
+    LockFreeChannel& operator=(const LockFreeChannel&) = delete;
+
+    // Approximations, when called concurrently.
+    bool empty() const noexcept
+    {
+        return queue_.size() == 0;
+    }
+    size_type size() const noexcept
+    {
+        return queue_.size();
+    }
+
+    template<typename ...Ts, typename = std::enable_if_t<!StartsWithStopToken<Ts...>::value>>
+    bool emplace(Ts&& ...Args)
+    {
+        return emplace_with(nullptr, WaitForever{}, std::forward<Ts>(Args)...);
+    }
+
+    template<typename ...Ts>
+    bool emplace(const StopToken& token, Ts&& ...Args)
+    {
+        return emplace_with(&token, WaitForever{}, std::forward<Ts>(Args)...);
+    }
+
+    // If T can't be constructed from the arguments without throwing, it is constructed first: They are moved from
+    // even when the channel turns out to be full.
+    template<typename ...Ts>
+    bool try_emplace(Ts&& ...Args)
+    {
+        return emplace_with(nullptr, NoWait{}, std::forward<Ts>(Args)...);
+    }
+
+    void close()
+    {
+        closed_.store(true);
+        ChannelWaiter* producers;
+        {
+            std::lock_guard lk(waiters_mtx_);
+            producers = emplace_waiters_.take_all();
+            nb_emplace_waiters_.store(0);
+        }
+        ChannelWaiterList::wake_all(producers);
+        if constexpr (Bounded) {
+            not_full_.notify_all();
+        }
+        wake_consumers(all_waiters);
+    }
+
+    bool pop(value_type& dst)
+    {
+        return pop_with(move_to(dst)) != 0;
+    }
 
     std::optional<value_type> pop()
     {
         std::optional<value_type> ret;
+        pop_with([&](value_type& item) { ret.emplace(std::move(item)); });
+        return ret;
+    }
 
-        if constexpr (!Bounded || !Sp) {
-            {
-                std::unique_lock lk(mtx_);
-                cond_pop_.wait(lk, [&] { return closed_ || !Container::empty(); });
-                if (Container::empty()) {
-                    return ret;
-                }
-                ret = std::move(Container::front());
-                Container::pop_front();
+    bool pop(const StopToken& token, value_type& dst)
+    {
+        return pop_with(move_to(dst), &token) != 0;
+    }
+
+    std::optional<value_type> pop(const StopToken& token)
+    {
+        std::optional<value_type> ret;
+        pop_with([&](value_type& item) { ret.emplace(std::move(item)); }, &token);
+        return ret;
+    }
+
+    bool try_pop(value_type& dst)
+    {
+        return pop_with(move_to(dst), nullptr, 1, NoWait{}) != 0;
+    }
+
+    std::optional<value_type> try_pop()
+    {
+        std::optional<value_type> ret;
+        pop_with([&](value_type& item) { ret.emplace(std::move(item)); }, nullptr, 1, NoWait{});
+        return ret;
+    }
+
+    template<class Clock, class Duration>
+    bool pop_until(const std::chrono::time_point<Clock, Duration>& deadline, value_type& dst)
+    {
+        return pop_with(move_to(dst), nullptr, 1, deadline) != 0;
+    }
+
+    template<class Clock, class Duration>
+    std::optional<value_type> pop_until(const std::chrono::time_point<Clock, Duration>& deadline)
+    {
+        std::optional<value_type> ret;
+        pop_with([&](value_type& item) { ret.emplace(std::move(item)); }, nullptr, 1, deadline);
+        return ret;
+    }
+
+    template<class Rep, class Period>
+    bool pop_for(const std::chrono::duration<Rep, Period>& timeout, value_type& dst)
+    {
+        return pop_until(std::chrono::steady_clock::now() + timeout, dst);
+    }
+
+    template<class Rep, class Period>
+    std::optional<value_type> pop_for(const std::chrono::duration<Rep, Period>& timeout)
+    {
+        return pop_until(std::chrono::steady_clock::now() + timeout);
+    }
+
+    // Batched operations, see Channel.
+
+    template<class OutputIt>
+    size_type pop_many(OutputIt out, size_type max_n)
+    {
+        if (max_n == 0) return 0;
+        return pop_with([&](value_type& item) { *out = std::move(item); ++out; }, nullptr, max_n);
+    }
+
+    size_type drain_into(std::vector<value_type>& dst, size_type max_n)
+    {
+        return pop_many(std::back_inserter(dst), max_n);
+    }
+
+    template<class InputIt>
+    size_type emplace_many(InputIt first, InputIt last)
+    {
+        if (first == last || !enter_push()) return 0;
+        size_type   nb_items   = 0;
+        std::size_t nb_unwoken = 0;
+        ScopeGuard leave([&] {
+            if (nb_unwoken != 0) wake_consumers(nb_unwoken);
+            if (leave_push()) wake_consumers(all_waiters);
+        });
+        for (; first != last && !closed_.load(std::memory_order_relaxed); ++first) {
+            bool pushed;
+            if constexpr (std::is_nothrow_constructible_v<T, decltype(*first)>) {
+                pushed = push_or_wait(nb_unwoken, *first);
+            } else {
+                pushed = push_or_wait(nb_unwoken, T(*first));
             }
-            if constexpr (Bounded) {
-                this->cond_emplace_.notify_one();
+            if (!pushed) break;
+            ++nb_items;
+        }
+        return nb_items;
+    }
+
+    // Consumer side.
+    void clear()
+    {
+        std::size_t nb_items = 0;
+        auto drop = [](value_type&) noexcept {};
+        while (queue_.try_consume(drop)) ++nb_items;
+        if (nb_items != 0) wake_producers(nb_items);
+    }
+
+    // Low-level hooks for the awaitables of clst/coro.hpp, see Channel.
+
+    bool pop_or_wait(ChannelPopWaiter<T>& w)
+    {
+        auto take = [&w](value_type& item) { w.value.emplace(std::move(item)); };
+        auto r    = try_take(take);
+        if (r == Popped::empty) {
+            std::lock_guard lk(waiters_mtx_);
+            nb_pop_waiters_.fetch_add(1);
+            // Re-check once announced: A producer either sees the announcement, or we see its item.
+            r = try_take(take);
+            if (r == Popped::empty) {
+                pop_waiters_.push(&w);
+                return false;
             }
-        } else {
-            bool should_notify;
-            {
-                std::unique_lock lk(mtx_);
-                cond_pop_.wait(lk, [&] { return closed_ || !Container::empty(); });
-                if (Container::empty()) {
-                    return ret;
+            nb_pop_waiters_.fetch_sub(1);
+        }
+        w.done = r == Popped::item;
+        if (w.done) wake_producers(1);
+        return true;
+    }
+
+    bool emplace_or_wait(ChannelEmplaceWaiter<T>& w)
+    {
+        if (!enter_push()) {
+            w.done = false;
+            return true;
+        }
+        bool pushed = try_push(std::move(*w.value));
+        if constexpr (Bounded) {
+            if (!pushed) {
+                std::unique_lock lk(waiters_mtx_);
+                nb_emplace_waiters_.fetch_add(1);
+                pushed = queue_.try_emplace(std::move(*w.value));
+                if (!pushed) {
+                    // Don't queue up once close() has taken the waiters.
+                    const bool queued = !closed_.load();
+                    if (queued) {
+                        emplace_waiters_.push(&w);
+                    } else {
+                        nb_emplace_waiters_.fetch_sub(1);
+                        w.done = false;
+                    }
+                    lk.unlock();
+                    if (leave_push()) wake_consumers(all_waiters);
+                    return !queued;
                 }
-                should_notify = Container::size() == this->max_;
-                ret = std::move(Container::front());
-                Container::pop_front();
+                nb_emplace_waiters_.fetch_sub(1);
             }
-            if (should_notify) {
-                this->cond_emplace_.notify_one();
+        }
+        w.done = true;
+        wake_consumers(1);
+        if (leave_push()) wake_consumers(all_waiters);
+        return true;
+    }
+
+protected:
+    template<typename ...Args>
+    explicit LockFreeChannel(Args&& ...args) : queue_(std::forward<Args>(args)...) {}
+
+private:
+    enum class Popped { item, empty, closed };
+
+    static constexpr std::size_t all_waiters = SIZE_MAX;
+
+    // Wakes up the threads blocked on an event, so that they see the stop request.
+    struct StopWaker {
+        EventCount<WaitPolicy>* event;
+
+        void operator()() noexcept
+        {
+            event->notify_all();
+        }
+    };
+
+    using StopWakeUp = std::optional<StopCallback<StopWaker>>;
+
+    Queue queue_;
+
+    alignas(cache_line_size) std::atomic<bool> closed_{false};
+    std::atomic<std::size_t>                   pushing_{0};
+
+    alignas(cache_line_size) EventCount<WaitPolicy> not_empty_;
+    alignas(cache_line_size) EventCount<WaitPolicy> not_full_;
+
+    // Suspended coroutines.
+    alignas(cache_line_size) std::atomic<std::uint32_t> nb_pop_waiters_{0};
+    std::atomic<std::uint32_t>                          nb_emplace_waiters_{0};
+    std::mutex                                          waiters_mtx_;
+    ChannelWaiterList                                   pop_waiters_;
+    ChannelWaiterList                                   emplace_waiters_;
+
+    static auto move_to(value_type& dst) noexcept
+    {
+        return [&dst](value_type& item) {
+            if constexpr (std::is_nothrow_move_assignable_v<value_type>) {
+                dst = std::move(item);
+            } else {
+                // Don't throw with the item half taken: Move it out first.
+                value_type tmp(std::move(item));
+                dst = std::move(tmp);
             }
+        };
+    }
+
+    // Returns false if closed.
+    bool enter_push()
+    {
+        pushing_.fetch_add(1);
+        if (!closed_.load()) return true;
+        if (leave_push()) wake_consumers(all_waiters);
+        return false;
+    }
+
+    // Returns true if the channel was closed, and this was the last push in flight:
+    // Consumers waiting for it to drain must be woken up then.
+    bool leave_push() noexcept
+    {
+        return pushing_.fetch_sub(1) == 1 && closed_.load();
+    }
+
+    // First attempt of a push, once entered. Leaves the push if the queue throws (allocating a node).
+    template<typename ...Ts>
+    bool try_push(Ts&& ...Args)
+    {
+        try {
+            return queue_.try_emplace(std::forward<Ts>(Args)...);
+        } catch (...) {
+            if (leave_push()) wake_consumers(all_waiters);
+            throw;
         }
+    }
 
-        return ret;
+    template<typename F>
+    Popped try_take(F& take)
+    {
+        if (queue_.try_consume(take)) return Popped::item;
+        if (!closed_.load() || pushing_.load() != 0) return Popped::empty;
+        // Closed, and no push in flight: Whatever is left is all there is.
+        return queue_.try_consume(take) ? Popped::item : Popped::closed;
     }
 
-    void clear()
+    // After pushing `count` items, or once drained after close() (`all_waiters`).
+    void wake_consumers(std::size_t count)
+    {
+        not_empty_.notify(count);
+        if (nb_pop_waiters_.load(std::memory_order_relaxed) != 0) serve_pop_waiters();
+    }
+
+    // After freeing `count` slots.
+    void wake_producers(std::size_t count)
     {
+        if constexpr (Bounded) {
+            not_full_.notify(count);
+            if (nb_emplace_waiters_.load(std::memory_order_relaxed) != 0) serve_emplace_waiters();
+        }
+    }
+
+    void serve_pop_waiters()
+    {
+        ChannelWaiterList served;
+        std::size_t nb_items = 0;
         {
-            std::lock_guard lk(mtx_);
-            Container::clear();
+            std::lock_guard lk(waiters_mtx_);
+            while (auto* const w = static_cast<ChannelPopWaiter<T>*>(pop_waiters_.front())) {
+                auto take = [w](value_type& item) { w->value.emplace(std::move(item)); };
+                const auto r = try_take(take);
+                if (r == Popped::empty) break;
+                pop_waiters_.pop();
+                nb_pop_waiters_.fetch_sub(1);
+                w->done = r == Popped::item;
+                nb_items += w->done;
+                served.push(w);
+            }
+        }
+        ChannelWaiterList::wake_all(served.take_all());
+        if (nb_items != 0) wake_producers(nb_items);
+    }
+
+    void serve_emplace_waiters()
+    {
+        ChannelWaiterList served;
+        std::size_t nb_items = 0;
+        bool        drained  = false;
+        {
+            std::lock_guard lk(waiters_mtx_);
+            while (auto* const w = static_cast<ChannelEmplaceWaiter<T>*>(emplace_waiters_.front())) {
+                // If closed meanwhile, close() takes the remaining waiters.
+                pushing_.fetch_add(1);
+                const bool pushed = !closed_.load() && queue_.try_emplace(std::move(*w->value));
+                drained |= leave_push();
+                if (!pushed) break;
+                emplace_waiters_.pop();
+                nb_emplace_waiters_.fetch_sub(1);
+                w->done = true;
+                ++nb_items;
+                served.push(w);
+            }
+        }
+        ChannelWaiterList::wake_all(served.take_all());
+        if (nb_items != 0 || drained) wake_consumers(drained ? all_waiters : nb_items);
+    }
+
+    template<typename Deadline, typename ...Ts>
+    bool emplace_with(const StopToken* token, const Deadline& deadline, Ts&& ...Args)
+    {
+        if constexpr (!std::is_nothrow_constructible_v<T, Ts&&...>) {
+            return emplace_with(token, deadline, T(std::forward<Ts>(Args)...));
+        } else {
+            const auto stopped = [&] { return token && token->stop_requested(); };
+            if (stopped() || !enter_push()) {
+                return false;
+            }
+            bool pushed = try_push(std::forward<Ts>(Args)...);
+            if constexpr (Bounded) {
+                if (!pushed) {
+                    StopWakeUp wake_up;
+                    if (token && token->stop_possible()) wake_up.emplace(*token, StopWaker{&not_full_});
+                    channel_wait(not_full_, deadline, [&] {
+                        return stopped() || closed_.load() || (pushed = queue_.try_emplace(std::forward<Ts>(Args)...));
+                    });
+                }
+            }
+            if (pushed) wake_consumers(1);
+            if (leave_push()) wake_consumers(all_waiters);
+            return pushed;
+        }
+    }
+
+    // Push a batch. The caller has entered the push, and wakes up consumers for the `nb_unwoken` items pushed.
+    // Returns false if the channel was closed while full.
+    template<typename ...Ts>
+    bool push_or_wait(std::size_t& nb_unwoken, Ts&& ...Args)
+    {
+        if (queue_.try_emplace(std::forward<Ts>(Args)...)) {
+            ++nb_unwoken;
+            return true;
         }
         if constexpr (Bounded) {
-            this->cond_emplace_.notify_all();
+            // Full: Let consumers at what's been pushed so far, then wait for room.
+            wake_consumers(std::exchange(nb_unwoken, 0));
+            bool pushed = false;
+            not_full_.wait([&] {
+                return closed_.load() || (pushed = queue_.try_emplace(std::forward<Ts>(Args)...));
+            });
+            nb_unwoken += pushed;
+            return pushed;
+        } else {
+            return false;
         }
     }
+
+    // Take up to `max_n` items, blocking for the first one only. Returns how many were taken.
+    template<typename F, typename Deadline = WaitForever>
+    std::size_t
+    pop_with(F&& take, const StopToken* token = nullptr, std::size_t max_n = 1, const Deadline& deadline = {})
+    {
+        const auto stopped = [&] { return token && token->stop_requested(); };
+        if (stopped()) {
+            return 0;
+        }
+        auto r = try_take(take);
+        if (r == Popped::empty) {
+            StopWakeUp wake_up;
+            if (token && token->stop_possible()) wake_up.emplace(*token, StopWaker{&not_empty_});
+            channel_wait(not_empty_, deadline, [&] { return stopped() || (r = try_take(take)) != Popped::empty; });
+        }
+        if (r != Popped::item) {
+            return 0;
+        }
+        std::size_t nb_items = 1;
+        while (nb_items < max_n && queue_.try_consume(take)) ++nb_items;
+        wake_producers(nb_items);
+        return nb_items;
+    }
+};
+
+} // namespace detail
+
+/**
+ * Bounded SPSC channel, over a wait-free ring (see detail::SpscRing).
+ *
+ * Only one thread at a time may emplace, and only one may pop or clear. Any thread may close.
+ */
+template<class T, class WaitPolicy>
+class Channel<T, true, true, true, WaitPolicy, true>
+: public detail::LockFreeChannel<T, detail::SpscRing<T>, true, true, true, WaitPolicy> {
+public:
+    Channel(std::size_t max_items)
+    : detail::LockFreeChannel<T, detail::SpscRing<T>, true, true, true, WaitPolicy>((assert(max_items > 0), max_items))
+    {
+    }
+};
+
+/**
+ * Bounded MPMC channel, over a lock-free ring of sequence-numbered slots (see detail::MpmcRing).
+ *
+ * Producers and consumers only contend on claiming a slot, never on a lock.
+ */
+template<class T, class WaitPolicy>
+class Channel<T, true, false, false, WaitPolicy, true>
+: public detail::LockFreeChannel<T, detail::MpmcRing<T>, true, false, false, WaitPolicy> {
+public:
+    Channel(std::size_t max_items)
+    : detail::LockFreeChannel<T, detail::MpmcRing<T>, true, false, false, WaitPolicy>((assert(max_items > 0), max_items))
+    {
+    }
+};
+
+/**
+ * Unbounded single-consumer channel, over an intrusive node-based queue (see detail::MpscQueue).
+ *
+ * Producers push with one atomic exchange. Nodes are pooled per channel, so steady traffic doesn't allocate.
+ * Only one thread at a time may pop or clear.
+ */
+template<class T, bool Sp, class WaitPolicy>
+class Channel<T, false, Sp, true, WaitPolicy, true>
+: public detail::LockFreeChannel<T, detail::MpscQueue<T, Sp>, false, Sp, true, WaitPolicy> {
+public:
+    Channel() : detail::LockFreeChannel<T, detail::MpscQueue<T, Sp>, false, Sp, true, WaitPolicy>() {}
 };
 
 // Partial CTAD isn't possible, so we resort to factory functions
 // to deduce `Bounded` based on whether a max_size argument is provided.
 
-template<class T, bool Sp = false, bool Sc = false>
+template<class T, bool Sp = false, bool Sc = false, class WaitPolicy = BlockingWait>
 inline auto make_channel()
 {
-    return Channel<T, false, Sp, Sc>{};
+    return Channel<T, false, Sp, Sc, WaitPolicy>{};
 }
 
-template<class T, bool Sp = false, bool Sc = false>
+template<class T, bool Sp = false, bool Sc = false, class WaitPolicy = BlockingWait>
 inline auto make_channel(typename std::deque<T>::size_type max_size)
 {
-    return Channel<T, true, Sp, Sc>{max_size};
+    return Channel<T, true, Sp, Sc, WaitPolicy>{max_size};
 }
 
 } // namespace clst
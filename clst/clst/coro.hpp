@@ -0,0 +1,488 @@
+#ifndef CLST_CORO_HPP
+#define CLST_CORO_HPP
+
+#include "clst/builtins.h"
+
+#if CLST_CPP20
+
+#include <cassert>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include "clst/channel.hpp"
+#include "clst/future.hpp"
+#include "clst/thread_pool.hpp"
+
+/**
+ * C++20 coroutines on top of clst::ThreadPool<void>.
+ *
+ * - `co_await pool.schedule()` moves the calling coroutine onto a worker.
+ * - Task<T> is a lazy coroutine, started by co_await-ing it. It resumes its awaiter by symmetric transfer,
+ *   so deep chains of tasks don't grow the stack. spawn(pool, task) starts one from regular code, and returns a Future.
+ * - pop_async() and emplace_async() wait on a Channel without blocking a thread.
+ *
+ * Frames of Task<T, RecycledFrames> come from per-thread caches (hence per-worker, on a pool) of a few size classes,
+ * instead of the global allocator.
+ *
+ * A coroutine whose resumption is dropped by ThreadPool::stop_now() is resumed on the dropping thread instead,
+ * so that its frame isn't leaked: schedule() then throws Pool::EnqueueBlocked.
+ */
+
+namespace clst {
+
+// Frame allocation policies for Task.
+struct HeapFrames {};
+struct RecycledFrames {};
+
+namespace detail {
+
+// Pool task resuming a coroutine. If dropped unrun, it resumes it right away, flagging `dropped`.
+class ResumeJob {
+public:
+    ResumeJob(std::coroutine_handle<> h, bool* dropped) noexcept : h_(h), dropped_(dropped) {}
+    ResumeJob(ResumeJob&& other) noexcept : h_(std::exchange(other.h_, nullptr)), dropped_(other.dropped_) {}
+    ResumeJob& operator=(ResumeJob&&) = delete;
+
+    ~ResumeJob()
+    {
+        if (h_) {
+            if (dropped_) *dropped_ = true;
+            h_.resume();
+        }
+    }
+
+    void operator()()
+    {
+        std::exchange(h_, nullptr).resume();
+    }
+
+private:
+    std::coroutine_handle<> h_;
+    bool*                   dropped_;
+};
+
+template<class Pool>
+class ScheduleAwaiter {
+    static_assert(std::is_void_v<typename Pool::ReturnType>, "Coroutines require a ThreadPool<void>");
+
+public:
+    explicit ScheduleAwaiter(Pool& pool) noexcept : pool_(pool) {}
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> h) noexcept
+    {
+        try {
+            pool_.enqueue(ResumeJob(h, &dropped_));
+        } catch (...) {
+            // The job resumed us on its way out. We may be gone by now.
+        }
+    }
+
+    void await_resume() const
+    {
+        if (dropped_) throw typename Pool::EnqueueBlocked{};
+    }
+
+private:
+    Pool& pool_;
+    bool  dropped_ = false;
+};
+
+// Where a Channel waiter resumes: Inline, on the thread that completed its operation, or on a pool.
+class Resumer {
+public:
+    Resumer() noexcept = default;
+
+    template<class Pool, typename = std::enable_if_t<!std::is_same_v<Pool, Resumer>>>
+    explicit Resumer(Pool& pool) noexcept : pool_(&pool), resume_(&resume_on<Pool>)
+    {}
+
+    void operator()(std::coroutine_handle<> h) const noexcept
+    {
+        if (pool_) {
+            resume_(pool_, h);
+        } else {
+            h.resume();
+        }
+    }
+
+private:
+    void* pool_                                     = nullptr;
+    void (*resume_)(void*, std::coroutine_handle<>) = nullptr;
+
+    template<class Pool>
+    static void resume_on(void* pool, std::coroutine_handle<> h) noexcept
+    {
+        try {
+            static_cast<Pool*>(pool)->enqueue(ResumeJob(h, nullptr));
+        } catch (...) {
+            // Resumed inline by the job. The operation went through anyway.
+        }
+    }
+};
+
+template<class Channel>
+class PopAwaiter : detail::ChannelPopWaiter<typename Channel::value_type> {
+public:
+    PopAwaiter(Channel& ch, Resumer resumer) noexcept : ch_(ch), resumer_(resumer)
+    {
+        this->wake = &wake_up;
+    }
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    bool await_suspend(std::coroutine_handle<> h)
+    {
+        h_ = h;
+        return !ch_.pop_or_wait(*this);
+    }
+
+    std::optional<typename Channel::value_type> await_resume()
+    {
+        return std::move(this->value);
+    }
+
+private:
+    Channel&                ch_;
+    Resumer                 resumer_;
+    std::coroutine_handle<> h_;
+
+    static void wake_up(ChannelWaiter* w) noexcept
+    {
+        auto* const self = static_cast<PopAwaiter*>(w);
+        self->resumer_(self->h_);
+    }
+};
+
+template<class Channel>
+class EmplaceAwaiter : detail::ChannelEmplaceWaiter<typename Channel::value_type> {
+public:
+    EmplaceAwaiter(Channel& ch, Resumer resumer, typename Channel::value_type&& value)
+    : ch_(ch), resumer_(resumer), item_(std::move(value))
+    {
+        this->wake  = &wake_up;
+        this->value = &item_;
+    }
+
+    // Not movable, as the channel points into it.
+    EmplaceAwaiter(const EmplaceAwaiter&) = delete;
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    bool await_suspend(std::coroutine_handle<> h)
+    {
+        h_ = h;
+        return !ch_.emplace_or_wait(*this);
+    }
+
+    bool await_resume() const noexcept
+    {
+        return this->done;
+    }
+
+private:
+    Channel&                    ch_;
+    Resumer                     resumer_;
+    std::coroutine_handle<>     h_;
+    typename Channel::value_type item_;
+
+    static void wake_up(ChannelWaiter* w) noexcept
+    {
+        auto* const self = static_cast<EmplaceAwaiter*>(w);
+        self->resumer_(self->h_);
+    }
+};
+
+// Frames are rounded up to size classes of this many bytes. Larger ones go to the global allocator.
+inline constexpr std::size_t frame_granularity = 64;
+inline constexpr std::size_t nb_frame_classes  = 16;
+
+template<std::size_t... I>
+void*
+allocate_frame(std::size_t cls, std::index_sequence<I...>)
+{
+    static constexpr void* (*table[])() = {
+        &BlockCache<(I + 1) * frame_granularity, __STDCPP_DEFAULT_NEW_ALIGNMENT__>::allocate...};
+    return table[cls]();
+}
+
+template<std::size_t... I>
+void
+deallocate_frame(void* p, std::size_t cls, std::index_sequence<I...>) noexcept
+{
+    static constexpr void (*table[])(void*) noexcept = {
+        &BlockCache<(I + 1) * frame_granularity, __STDCPP_DEFAULT_NEW_ALIGNMENT__>::deallocate...};
+    table[cls](p);
+}
+
+template<class Frames>
+struct FrameAllocator {};
+
+template<>
+struct FrameAllocator<RecycledFrames> {
+    static void* operator new(std::size_t size)
+    {
+        const auto cls = (size - 1) / frame_granularity;
+        if (cls >= nb_frame_classes) return ::operator new(size);
+        return allocate_frame(cls, std::make_index_sequence<nb_frame_classes>{});
+    }
+
+    static void operator delete(void* p, std::size_t size) noexcept
+    {
+        const auto cls = (size - 1) / frame_granularity;
+        if (cls >= nb_frame_classes) return ::operator delete(p);
+        deallocate_frame(p, cls, std::make_index_sequence<nb_frame_classes>{});
+    }
+};
+
+// Resumes the awaiter of a finished task, if any.
+struct FinalAwaiter {
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    template<class Promise>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept
+    {
+        const auto cont = h.promise().continuation;
+        return cont ? cont : std::noop_coroutine();
+    }
+
+    void await_resume() const noexcept {}
+};
+
+template<class Frames>
+struct TaskPromiseBase : FrameAllocator<Frames> {
+    std::coroutine_handle<> continuation;
+    std::exception_ptr      error;
+
+    std::suspend_always initial_suspend() const noexcept
+    {
+        return {};
+    }
+
+    FinalAwaiter final_suspend() const noexcept
+    {
+        return {};
+    }
+
+    void unhandled_exception() noexcept
+    {
+        error = std::current_exception();
+    }
+};
+
+template<typename T, class Frames>
+struct TaskPromise : TaskPromiseBase<Frames> {
+    std::optional<T> value;
+
+    template<typename U = T>
+    void return_value(U&& v)
+    {
+        value.emplace(std::forward<U>(v));
+    }
+
+    T result()
+    {
+        if (this->error) std::rethrow_exception(this->error);
+        return std::move(*value);
+    }
+};
+
+template<class Frames>
+struct TaskPromise<void, Frames> : TaskPromiseBase<Frames> {
+    void return_void() const noexcept {}
+
+    void result()
+    {
+        if (this->error) std::rethrow_exception(this->error);
+    }
+};
+
+} // namespace detail
+
+/**
+ * Lazy coroutine returning a T. It starts when awaited, and resumes its awaiter when done.
+ * Exceptions propagate to the awaiter.
+ */
+template<typename T = void, class Frames = HeapFrames>
+class [[nodiscard]] Task {
+public:
+    struct promise_type : detail::TaskPromise<T, Frames> {
+        Task get_return_object() noexcept
+        {
+            return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+    };
+
+    Task() noexcept = default;
+
+    Task(Task&& other) noexcept : h_(std::exchange(other.h_, nullptr)) {}
+
+    Task& operator=(Task&& other) noexcept
+    {
+        if (this != &other) {
+            if (h_) h_.destroy();
+            h_ = std::exchange(other.h_, nullptr);
+        }
+        return *this;
+    }
+
+    ~Task()
+    {
+        if (h_) h_.destroy();
+    }
+
+    bool valid() const noexcept
+    {
+        return static_cast<bool>(h_);
+    }
+
+    auto operator co_await() && noexcept
+    {
+        struct Awaiter {
+            std::coroutine_handle<promise_type> h;
+
+            bool await_ready() const noexcept
+            {
+                return h.done();
+            }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) noexcept
+            {
+                h.promise().continuation = awaiter;
+                return h; // Symmetric transfer: Start the task, without nesting.
+            }
+
+            T await_resume()
+            {
+                return h.promise().result();
+            }
+        };
+        assert(valid());
+        return Awaiter{h_};
+    }
+
+private:
+    std::coroutine_handle<promise_type> h_;
+
+    explicit Task(std::coroutine_handle<promise_type> h) noexcept : h_(h) {}
+};
+
+namespace detail {
+
+// Fire-and-forget coroutine, which frees itself when done.
+struct Detached {
+    struct promise_type {
+        Detached get_return_object() const noexcept
+        {
+            return {};
+        }
+
+        std::suspend_never initial_suspend() const noexcept
+        {
+            return {};
+        }
+
+        std::suspend_never final_suspend() const noexcept
+        {
+            return {};
+        }
+
+        void return_void() const noexcept {}
+
+        void unhandled_exception() const noexcept
+        {
+            std::terminate(); // Everything is caught below
+        }
+    };
+};
+
+template<class Pool, typename T, class Frames>
+Detached
+run_detached(Pool& pool, Task<T, Frames> task, Promise<T> promise)
+{
+    try {
+        co_await pool.schedule();
+        if constexpr (std::is_void_v<T>) {
+            co_await std::move(task);
+            promise.set_value();
+        } else {
+            promise.set_value(co_await std::move(task));
+        }
+    } catch (...) {
+        promise.set_exception(std::current_exception());
+    }
+}
+
+} // namespace detail
+
+/**
+ * Start `task` on `pool`, and get a Future for its result. Continuations of the Future run on the same pool.
+ */
+template<class Pool, typename T, class Frames>
+Future<T>
+spawn(Pool& pool, Task<T, Frames> task)
+{
+    Promise<T> promise{Executor(pool)};
+    auto       ret = promise.get_future();
+    detail::run_detached(pool, std::move(task), std::move(promise));
+    return ret;
+}
+
+/**
+ * `co_await pop_async(channel)` pops an item, or std::nullopt once the channel is closed and empty.
+ * If it has to wait, the coroutine is resumed by the thread that pushes the item, or on `pool` if given.
+ */
+template<class Channel>
+auto
+pop_async(Channel& ch) noexcept
+{
+    return detail::PopAwaiter<Channel>(ch, detail::Resumer{});
+}
+
+template<class Channel, class Pool>
+auto
+pop_async(Channel& ch, Pool& pool) noexcept
+{
+    return detail::PopAwaiter<Channel>(ch, detail::Resumer(pool));
+}
+
+/**
+ * `co_await emplace_async(channel, value)` pushes `value`, and returns false if the channel is closed.
+ * If it has to wait for room, the coroutine is resumed by the thread that pops an item, or on `pool` if given.
+ */
+template<class Channel>
+auto
+emplace_async(Channel& ch, typename Channel::value_type value)
+{
+    return detail::EmplaceAwaiter<Channel>(ch, detail::Resumer{}, std::move(value));
+}
+
+template<class Channel, class Pool>
+auto
+emplace_async(Channel& ch, Pool& pool, typename Channel::value_type value)
+{
+    return detail::EmplaceAwaiter<Channel>(ch, detail::Resumer(pool), std::move(value));
+}
+
+} // namespace clst
+
+#endif // CLST_CPP20
+
+#endif // CLST_CORO_HPP
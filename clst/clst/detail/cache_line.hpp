@@ -0,0 +1,14 @@
+#ifndef CLST_DETAIL_CACHE_LINE_HPP
+#define CLST_DETAIL_CACHE_LINE_HPP
+
+#include <cstddef>
+
+namespace clst::detail {
+
+// std::hardware_destructive_interference_size is not reliably available (and GCC warns about its ABI stability),
+// so we hard-code the common value. Used for padding data that is written by different threads.
+inline constexpr std::size_t cache_line_size = 64;
+
+} // namespace clst::detail
+
+#endif // CLST_DETAIL_CACHE_LINE_HPP
@@ -0,0 +1,137 @@
+#ifndef CLST_DETAIL_CHASE_LEV_DEQUE_HPP
+#define CLST_DETAIL_CHASE_LEV_DEQUE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <type_traits>
+#include "clst/detail/cache_line.hpp"
+
+namespace clst::detail {
+
+/**
+ * Chase-Lev work-stealing deque.
+ *
+ * The owner thread pushes and pops at the bottom (LIFO), any other thread may steal from the top (FIFO).
+ * Memory orderings follow Lê et al., "Correct and Efficient Work-Stealing for Weak Memory Models" (PPoPP'13).
+ *
+ * Elements are read speculatively by thieves, so T must be trivially copyable (in practice, a pointer).
+ * The buffer grows on demand. Retired buffers are kept alive until destruction, since a thief may still be reading them.
+ */
+template<typename T>
+class ChaseLevDeque {
+    static_assert(std::is_trivially_copyable_v<T>);
+
+    struct Buffer {
+        std::int64_t                   capacity;
+        std::unique_ptr<std::atomic<T>[]> slots;
+
+        explicit Buffer(std::int64_t cap) : capacity(cap), slots(new std::atomic<T>[static_cast<std::size_t>(cap)]) {}
+
+        T get(std::int64_t i) const noexcept
+        {
+            return slots[static_cast<std::size_t>(i & (capacity - 1))].load(std::memory_order_relaxed);
+        }
+        void put(std::int64_t i, T x) noexcept
+        {
+            slots[static_cast<std::size_t>(i & (capacity - 1))].store(x, std::memory_order_relaxed);
+        }
+    };
+
+public:
+    enum class StealResult { Success, Empty, Abort };
+
+    explicit ChaseLevDeque(std::int64_t capacity = 256)
+    {
+        // capacity must be a power of 2
+        buffers_.emplace_back(std::make_unique<Buffer>(capacity));
+        buffer_.store(buffers_.back().get(), std::memory_order_relaxed);
+    }
+
+    // Not copiable or movable.
+    ChaseLevDeque(const ChaseLevDeque&) = delete;
+    ChaseLevDeque& operator=(const ChaseLevDeque&) = delete;
+
+    // Owner only.
+    void push(T x)
+    {
+        const auto b   = bottom_.load(std::memory_order_relaxed);
+        const auto t   = top_.load(std::memory_order_acquire);
+        auto*      buf = buffer_.load(std::memory_order_relaxed);
+        if (b - t > buf->capacity - 1) {
+            buf = grow(buf, b, t);
+        }
+        buf->put(b, x);
+        // The paper uses a release fence followed by a relaxed store, which is equivalent (and TSan-friendlier).
+        bottom_.store(b + 1, std::memory_order_release);
+    }
+
+    // Owner only.
+    bool pop(T& x) noexcept
+    {
+        const auto b   = bottom_.load(std::memory_order_relaxed) - 1;
+        auto*      buf = buffer_.load(std::memory_order_relaxed);
+        bottom_.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto t = top_.load(std::memory_order_relaxed);
+
+        if (t > b) { // empty
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+        x = buf->get(b);
+        if (t == b) { // last element, race against thieves
+            const bool won = top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    // Any thread.
+    StealResult steal(T& x) noexcept
+    {
+        auto t = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const auto b = bottom_.load(std::memory_order_acquire);
+        if (t >= b) {
+            return StealResult::Empty;
+        }
+        // The consume ordering of the paper, strengthened to acquire.
+        const auto* buf = buffer_.load(std::memory_order_acquire);
+        x = buf->get(t);
+        if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return StealResult::Abort;
+        }
+        return StealResult::Success;
+    }
+
+    // Approximation, when called concurrently.
+    bool empty() const noexcept
+    {
+        return bottom_.load(std::memory_order_relaxed) <= top_.load(std::memory_order_relaxed);
+    }
+
+private:
+    alignas(cache_line_size) std::atomic<std::int64_t> top_{0};
+    alignas(cache_line_size) std::atomic<std::int64_t> bottom_{0};
+    std::atomic<Buffer*> buffer_{nullptr};
+    std::vector<std::unique_ptr<Buffer>> buffers_; // Owner only
+
+    Buffer* grow(const Buffer* old, std::int64_t b, std::int64_t t)
+    {
+        auto  fresh = std::make_unique<Buffer>(old->capacity * 2);
+        auto* ret   = fresh.get();
+        for (auto i = t; i != b; ++i) {
+            ret->put(i, old->get(i));
+        }
+        buffers_.emplace_back(std::move(fresh));
+        buffer_.store(ret, std::memory_order_release);
+        return ret;
+    }
+};
+
+} // namespace clst::detail
+
+#endif // CLST_DETAIL_CHASE_LEV_DEQUE_HPP
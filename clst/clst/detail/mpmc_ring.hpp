@@ -0,0 +1,144 @@
+#ifndef CLST_DETAIL_MPMC_RING_HPP
+#define CLST_DETAIL_MPMC_RING_HPP
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include "clst/detail/cache_line.hpp"
+
+namespace clst::detail {
+
+/**
+ * Bounded lock-free MPMC queue, after Dmitry Vyukov's design.
+ *
+ * Every slot carries a sequence number, which tells whether it's ready to be written to (seq == 2 * pos)
+ * or to be read from (seq == 2 * pos + 1) in the current lap. (Doubling keeps the two states apart with a single slot.)
+ * Producers and consumers each claim a position with a CAS, and then own the slot exclusively, so T can be any
+ * movable type.
+ *
+ * The capacity is exact: The slot array is rounded up to a power of 2, but a producer only claims a position less than
+ * `capacity` ahead of the consumers' position.
+ */
+template<typename T>
+class MpmcRing {
+public:
+    explicit MpmcRing(std::size_t capacity)
+    : capacity_(capacity), mask_(round_up(capacity) - 1), slots_(std::make_unique<Slot[]>(mask_ + 1))
+    {
+        for (std::size_t i = 0; i <= mask_; ++i) {
+            slots_[i].seq.store(2 * i, std::memory_order_relaxed);
+        }
+    }
+
+    ~MpmcRing()
+    {
+        const auto end = enqueue_pos_.load(std::memory_order_relaxed);
+        for (auto pos = dequeue_pos_.load(std::memory_order_relaxed); pos != end; ++pos) {
+            std::launder(reinterpret_cast<T*>(slots_[pos & mask_].storage))->~T();
+        }
+    }
+
+    // Not copiable or movable.
+    MpmcRing(const MpmcRing&) = delete;
+    MpmcRing& operator=(const MpmcRing&) = delete;
+
+    // Returns false if full. Arguments are left untouched in that case.
+    template<typename... Ts>
+    bool try_emplace(Ts&&... args)
+    {
+        auto  pos = enqueue_pos_.load(std::memory_order_relaxed);
+        Slot* slot;
+        for (;;) {
+            slot            = &slots_[pos & mask_];
+            const auto seq  = slot->seq.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::ptrdiff_t>(seq - 2 * pos);
+            if (diff == 0) {
+                // With spare slots, the slot being free doesn't mean we're below capacity. A stale dequeue_pos_ only
+                // makes us err on the side of full. (If `pos` is stale instead, the CAS below fails anyway.)
+                if (capacity_ <= mask_) {
+                    const auto ahead = static_cast<std::ptrdiff_t>(pos - dequeue_pos_.load(std::memory_order_relaxed));
+                    if (ahead >= static_cast<std::ptrdiff_t>(capacity_)) return false;
+                }
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                return false; // Slot from the previous lap is still occupied
+            } else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        ::new (static_cast<void*>(slot->storage)) T(std::forward<Ts>(args)...);
+        slot->seq.store(2 * pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Returns false if empty.
+    bool try_pop(T& dst)
+    {
+        return try_consume([&dst](T& item) { dst = std::move(item); });
+    }
+
+    // Moves the front item out with `take(T&)`. Returns false if empty.
+    template<typename F>
+    bool try_consume(F&& take)
+    {
+        auto  pos = dequeue_pos_.load(std::memory_order_relaxed);
+        Slot* slot;
+        for (;;) {
+            slot            = &slots_[pos & mask_];
+            const auto seq  = slot->seq.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::ptrdiff_t>(seq - (2 * pos + 1));
+            if (diff == 0) {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                return false; // Not written yet
+            } else {
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        auto* p = std::launder(reinterpret_cast<T*>(slot->storage));
+        take(*p);
+        p->~T();
+        slot->seq.store(2 * (pos + mask_ + 1), std::memory_order_release);
+        return true;
+    }
+
+    // Approximation, when called concurrently.
+    std::size_t size() const noexcept
+    {
+        const auto deq = dequeue_pos_.load(std::memory_order_relaxed);
+        const auto enq = enqueue_pos_.load(std::memory_order_relaxed);
+        return enq > deq ? enq - deq : 0;
+    }
+
+    std::size_t capacity() const noexcept
+    {
+        return capacity_;
+    }
+
+private:
+    struct Slot {
+        std::atomic<std::size_t> seq;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    static std::size_t round_up(std::size_t n) noexcept
+    {
+        assert(n > 0);
+        std::size_t ret = 1;
+        while (ret < n) ret <<= 1;
+        return ret;
+    }
+
+    const std::size_t       capacity_;
+    const std::size_t       mask_;
+    std::unique_ptr<Slot[]> slots_;
+    alignas(cache_line_size) std::atomic<std::size_t> enqueue_pos_{0};
+    alignas(cache_line_size) std::atomic<std::size_t> dequeue_pos_{0};
+};
+
+} // namespace clst::detail
+
+#endif // CLST_DETAIL_MPMC_RING_HPP
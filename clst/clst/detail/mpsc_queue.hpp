@@ -0,0 +1,149 @@
+#ifndef CLST_DETAIL_MPSC_QUEUE_HPP
+#define CLST_DETAIL_MPSC_QUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <utility>
+#include "clst/detail/cache_line.hpp"
+
+namespace clst::detail {
+
+/**
+ * Unbounded MPSC queue, after Dmitry Vyukov's intrusive node-based queue.
+ *
+ * Producers swap their node into `tail_` (one atomic exchange), then link it behind the previous tail.
+ * The consumer owns `head_`, a dummy node whose successor is the front item. Popping makes that successor the new
+ * dummy, and recycles the old one. A producer stalled between the exchange and the link hides the items behind it
+ * from the consumer, until it gets going again.
+ *
+ * Nodes are pooled per queue. The consumer pushes the nodes it's done with onto `free_`, a stack only it pushes to.
+ * Producers only ever take the whole stack at once (an exchange, so no ABA), into a private cache they allocate from.
+ * With several producers, the cache is guarded by a try-lock, and a producer that finds it taken allocates instead.
+ * So a steady-state producer/consumer pair doesn't allocate at all. The consumer frees nodes beyond `max_free` instead
+ * of pooling them, which bounds what's kept around after a burst.
+ */
+template<typename T, bool Sp>
+class MpscQueue {
+public:
+    static constexpr std::size_t max_free = 4096;
+
+    MpscQueue() : head_(new Node)
+    {
+        tail_.store(head_, std::memory_order_relaxed);
+    }
+
+    ~MpscQueue()
+    {
+        for (auto* n = head_->next.load(std::memory_order_relaxed); n; n = n->next.load(std::memory_order_relaxed)) {
+            n->item()->~T();
+        }
+        delete_list(head_);
+        delete_list(free_.load(std::memory_order_relaxed));
+        delete_list(cache_);
+    }
+
+    // Not copiable or movable.
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    // Any producer. Never full, but may throw std::bad_alloc, before anything is published.
+    template<typename... Ts>
+    bool try_emplace(Ts&&... args)
+    {
+        auto* const n = alloc_node();
+        ::new (static_cast<void*>(n->storage)) T(std::forward<Ts>(args)...);
+        n->next.store(nullptr, std::memory_order_relaxed);
+        nb_pushed_.fetch_add(1, std::memory_order_relaxed);
+        auto* const prev = tail_.exchange(n, std::memory_order_acq_rel);
+        prev->next.store(n, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only. Moves the front item out with `take(T&)`. Returns false if empty.
+    template<typename F>
+    bool try_consume(F&& take)
+    {
+        auto* const dummy = head_;
+        auto* const next  = dummy->next.load(std::memory_order_acquire);
+        if (!next) return false;
+        auto* const p = next->item();
+        take(*p);
+        p->~T();
+        head_ = next;
+        nb_popped_.store(nb_popped_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        recycle(dummy);
+        return true;
+    }
+
+    // Approximation, when called concurrently.
+    std::size_t size() const noexcept
+    {
+        const auto popped = nb_popped_.load(std::memory_order_relaxed);
+        const auto pushed = nb_pushed_.load(std::memory_order_relaxed);
+        return pushed > popped ? pushed - popped : 0;
+    }
+
+private:
+    struct Node {
+        // Next item in the queue, or next node in the pool.
+        std::atomic<Node*> next{nullptr};
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        T* item() noexcept
+        {
+            return std::launder(reinterpret_cast<T*>(storage));
+        }
+    };
+
+    static void delete_list(Node* n) noexcept
+    {
+        while (n) {
+            delete std::exchange(n, n->next.load(std::memory_order_relaxed));
+        }
+    }
+
+    Node* alloc_node()
+    {
+        if constexpr (!Sp) {
+            if (cache_lock_.exchange(true, std::memory_order_acquire)) return new Node;
+        }
+        if (!cache_) cache_ = free_.exchange(nullptr, std::memory_order_acquire);
+        auto* const n = cache_;
+        if (n) cache_ = n->next.load(std::memory_order_relaxed);
+        if constexpr (!Sp) {
+            cache_lock_.store(false, std::memory_order_release);
+        }
+        return n ? n : new Node;
+    }
+
+    void recycle(Node* n) noexcept
+    {
+        auto* head = free_.load(std::memory_order_relaxed);
+        // Producers only ever empty the stack: If it's not empty, it holds exactly what we've pushed since.
+        if (head && nb_free_ >= max_free) {
+            delete n;
+            return;
+        }
+        do {
+            n->next.store(head, std::memory_order_relaxed);
+        } while (!free_.compare_exchange_weak(head, n, std::memory_order_release, std::memory_order_relaxed));
+        nb_free_ = head ? nb_free_ + 1 : 1;
+    }
+
+    // Producer side
+    alignas(cache_line_size) std::atomic<Node*> tail_{nullptr};
+    std::atomic<std::size_t>                    nb_pushed_{0};
+    std::atomic<bool>                           cache_lock_{false}; // Unused with a single producer
+    Node*                                       cache_ = nullptr;
+    // Consumer side
+    alignas(cache_line_size) Node*              head_;
+    std::atomic<std::size_t>                    nb_popped_{0};
+    std::size_t                                 nb_free_ = 0;
+    // Node pool, pushed by the consumer, taken by producers.
+    alignas(cache_line_size) std::atomic<Node*> free_{nullptr};
+};
+
+} // namespace clst::detail
+
+#endif // CLST_DETAIL_MPSC_QUEUE_HPP
@@ -0,0 +1,118 @@
+#ifndef CLST_DETAIL_SPSC_RING_HPP
+#define CLST_DETAIL_SPSC_RING_HPP
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include "clst/detail/cache_line.hpp"
+
+namespace clst::detail {
+
+/**
+ * Bounded wait-free SPSC queue.
+ *
+ * The producer owns `tail_`, the consumer owns `head_`. Both only ever increase, and index a power-of-2 slot array.
+ * Each side keeps a cached copy of the other side's index, and only reloads it (an acquire load of a cache line
+ * written by the other thread) when the cached value says the queue is full, or empty.
+ * So in steady state, the two threads don't touch each other's cache lines for every item.
+ *
+ * The capacity is exact: The slot array is rounded up, but never filled beyond `capacity`.
+ */
+template<typename T>
+class SpscRing {
+public:
+    explicit SpscRing(std::size_t capacity)
+    : capacity_(capacity), mask_(round_up(capacity) - 1), slots_(std::make_unique<Slot[]>(mask_ + 1))
+    {
+    }
+
+    ~SpscRing()
+    {
+        const auto end = tail_.load(std::memory_order_relaxed);
+        for (auto pos = head_.load(std::memory_order_relaxed); pos != end; ++pos) {
+            item(pos)->~T();
+        }
+    }
+
+    // Not copiable or movable.
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Producer only. Returns false if full. Arguments are left untouched in that case.
+    template<typename... Ts>
+    bool try_emplace(Ts&&... args)
+    {
+        const auto pos = tail_.load(std::memory_order_relaxed);
+        if (pos - head_cache_ >= capacity_) {
+            head_cache_ = head_.load(std::memory_order_acquire);
+            if (pos - head_cache_ >= capacity_) return false;
+        }
+        ::new (static_cast<void*>(slots_[pos & mask_].storage)) T(std::forward<Ts>(args)...);
+        tail_.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only. Moves the front item out with `take(T&)`. Returns false if empty.
+    template<typename F>
+    bool try_consume(F&& take)
+    {
+        const auto pos = head_.load(std::memory_order_relaxed);
+        if (pos == tail_cache_) {
+            tail_cache_ = tail_.load(std::memory_order_acquire);
+            if (pos == tail_cache_) return false;
+        }
+        auto* const p = item(pos);
+        take(*p);
+        p->~T();
+        head_.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximation, when called concurrently.
+    std::size_t size() const noexcept
+    {
+        const auto head = head_.load(std::memory_order_relaxed);
+        const auto tail = tail_.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+
+    std::size_t capacity() const noexcept
+    {
+        return capacity_;
+    }
+
+private:
+    struct Slot {
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    static std::size_t round_up(std::size_t n) noexcept
+    {
+        assert(n > 0);
+        std::size_t ret = 1;
+        while (ret < n) ret <<= 1;
+        return ret;
+    }
+
+    T* item(std::size_t pos) noexcept
+    {
+        return std::launder(reinterpret_cast<T*>(slots_[pos & mask_].storage));
+    }
+
+    const std::size_t       capacity_;
+    const std::size_t       mask_;
+    std::unique_ptr<Slot[]> slots_;
+    // Producer side
+    alignas(cache_line_size) std::atomic<std::size_t> tail_{0};
+    std::size_t                                       head_cache_ = 0;
+    // Consumer side
+    alignas(cache_line_size) std::atomic<std::size_t> head_{0};
+    std::size_t                                       tail_cache_ = 0;
+};
+
+} // namespace clst::detail
+
+#endif // CLST_DETAIL_SPSC_RING_HPP
@@ -6,6 +6,7 @@
 #include <cstddef>
 #include <string>
 #include <system_error>
+#include <utility>
 
 
 namespace clst {
@@ -21,6 +22,9 @@ struct ArcStringRep {
     const std::string str; // Not meant to be mutable.
     std::atomic<std::ptrdiff_t> ref_cnt = 1;
 
+    // Not an aggregate in C++20, because of the deleted members below.
+    explicit ArcStringRep(std::string s) noexcept : str(std::move(s)) {}
+
     // Not meant to be copied or moved by myself.
     ArcStringRep(const ArcStringRep&) = delete;
     ArcStringRep& operator=(const ArcStringRep&) = delete;
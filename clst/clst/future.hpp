@@ -0,0 +1,959 @@
+#ifndef CLST_FUTURE_HPP
+#define CLST_FUTURE_HPP
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+#include "clst/wait_policy.hpp"
+
+/**
+ * Lightweight futures for clst::ThreadPool<void>, which compose without blocking a thread.
+ *
+ * - async(pool, f) runs f on the pool, and returns a Future for its result.
+ * - Future::then(f) runs f on the pool as soon as the result is in, and returns a Future for the result of f.
+ *   Exceptions skip the continuation, and propagate down the chain.
+ * - when_all() and when_any() combine a range of futures, without any extra task.
+ *
+ * Shared states and continuations are recycled through per-thread caches, so chaining doesn't go through
+ * the global allocator each time.
+ *
+ * Unlike std::future, a Future has a single consumer: get() and then() both consume it.
+ */
+
+namespace clst {
+
+template<typename T>
+class Future;
+template<typename T>
+class Promise;
+
+namespace detail {
+
+class Continuation;
+
+// Access to the shared state of a Future.
+struct FutureAccess;
+
+} // namespace detail
+
+/**
+ * Type-erased handle to the pool that runs continuations. A default-constructed Executor runs them right away,
+ * on the thread that completes the antecedent.
+ */
+class Executor {
+public:
+    Executor() noexcept = default;
+
+    template<typename Pool, typename = std::enable_if_t<!std::is_same_v<Pool, Executor>>>
+    explicit Executor(Pool& pool) noexcept : pool_(&pool), post_(&post_to<Pool>), help_(&help_with<Pool>),
+      can_help_(&is_worker_of<Pool>)
+    {
+        static_assert(std::is_void_v<typename Pool::ReturnType>, "Executor requires a ThreadPool<void>");
+    }
+
+    bool is_inline() const noexcept
+    {
+        return pool_ == nullptr;
+    }
+
+    // Run `c` on the pool. If the pool doesn't take any more tasks, `c` is cancelled.
+    void post(detail::Continuation* c) const noexcept;
+
+    // Whether the calling thread is a worker of the pool, and can run its tasks while waiting.
+    bool can_help() const noexcept
+    {
+        return can_help_ && can_help_(pool_);
+    }
+
+    // Run one pending task of the pool, if any.
+    bool help() const
+    {
+        return help_ && help_(pool_);
+    }
+
+private:
+    void* pool_                                 = nullptr;
+    void (*post_)(void*, detail::Continuation*) = nullptr;
+    bool (*help_)(void*)                        = nullptr;
+    bool (*can_help_)(const void*) noexcept     = nullptr;
+
+    template<typename Pool>
+    static void post_to(void* pool, detail::Continuation* c) noexcept;
+
+    template<typename Pool>
+    static bool help_with(void* pool)
+    {
+        return static_cast<Pool*>(pool)->run_pending_task();
+    }
+
+    template<typename Pool>
+    static bool is_worker_of(const void* pool) noexcept
+    {
+        return static_cast<const Pool*>(pool)->is_current_worker();
+    }
+};
+
+namespace detail {
+
+// Something to run once a shared state has its result.
+class Continuation {
+public:
+    Executor executor; // Where to run it
+
+    virtual void run() noexcept = 0;
+    // Called instead of run() if a posted continuation is dropped by the pool, e.g. through stop_now().
+    virtual void cancel() noexcept = 0;
+
+protected:
+    ~Continuation() = default;
+};
+
+inline std::exception_ptr
+broken_promise() noexcept
+{
+    return std::make_exception_ptr(std::future_error(std::future_errc::broken_promise));
+}
+
+// Pool task running a posted continuation. Cancels it if dropped unrun.
+class ContinuationJob {
+public:
+    explicit ContinuationJob(Continuation* c) noexcept : c_(c) {}
+    ContinuationJob(ContinuationJob&& other) noexcept : c_(std::exchange(other.c_, nullptr)) {}
+    ContinuationJob& operator=(ContinuationJob&&) = delete;
+
+    ~ContinuationJob()
+    {
+        if (c_) c_->cancel();
+    }
+
+    void operator()() noexcept
+    {
+        std::exchange(c_, nullptr)->run();
+    }
+
+private:
+    Continuation* c_;
+};
+
+/**
+ * Per-thread free list of blocks of one size. Blocks freed on another thread than the one that allocated them
+ * end up in the cache of that other thread, which is fine since they're all alike.
+ *
+ * A thread whose cache is full hands further blocks over to a stack shared by all threads, and a thread whose cache
+ * is empty takes that whole stack (an exchange, so no ABA) before going to the allocator. So blocks flow back from
+ * the threads that free them to the threads that allocate them, e.g. from workers to an outside thread chaining
+ * continuations. The shared stack holds up to `shared_capacity` blocks, for the life of the program.
+ */
+template<std::size_t Size, std::size_t Align>
+class BlockCache {
+public:
+    static void* allocate()
+    {
+        auto& cache = local();
+        if (!cache.head) cache.take_shared();
+        if (auto* b = cache.head) {
+            cache.head = b->next;
+            --cache.size;
+            return b;
+        }
+        if constexpr (Align > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+            return ::operator new(Size, std::align_val_t(Align));
+        } else {
+            return ::operator new(Size);
+        }
+    }
+
+    static void deallocate(void* p) noexcept
+    {
+        auto& cache = local();
+        auto* const b = ::new (p) Block;
+        if (cache.size < capacity) {
+            b->next    = cache.head;
+            cache.head = b;
+            ++cache.size;
+        } else if (shared_size_.load(std::memory_order_relaxed) < shared_capacity) {
+            shared_size_.fetch_add(1, std::memory_order_relaxed);
+            b->next = shared_.load(std::memory_order_relaxed);
+            while (!shared_.compare_exchange_weak(b->next, b, std::memory_order_release, std::memory_order_relaxed)) {}
+        } else {
+            free(b);
+        }
+    }
+
+private:
+    static constexpr std::size_t capacity        = 64;
+    static constexpr std::size_t shared_capacity = 1024;
+
+    // A free block.
+    struct Block {
+        Block* next;
+    };
+    static_assert(Size >= sizeof(Block) && Align >= alignof(Block));
+
+    struct Cache {
+        Block*      head = nullptr;
+        std::size_t size = 0;
+
+        ~Cache()
+        {
+            while (head) free(std::exchange(head, head->next));
+        }
+
+        void take_shared() noexcept
+        {
+            head = shared_.exchange(nullptr, std::memory_order_acquire);
+            std::size_t n = 0;
+            for (auto* b = head; b; b = b->next) ++n;
+            shared_size_.fetch_sub(n, std::memory_order_relaxed);
+            size = n;
+        }
+    };
+
+    static inline std::atomic<Block*>      shared_{nullptr};
+    static inline std::atomic<std::size_t> shared_size_{0}; // Approximation, when called concurrently
+
+    static Cache& local() noexcept
+    {
+        thread_local Cache cache;
+        return cache;
+    }
+
+    static void free(void* p) noexcept
+    {
+        if constexpr (Align > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+            ::operator delete(p, std::align_val_t(Align));
+        } else {
+            ::operator delete(p);
+        }
+    }
+};
+
+// Base for objects allocated through a BlockCache.
+template<class Derived>
+struct Recycled {
+    static void* operator new(std::size_t size)
+    {
+        assert(size == sizeof(Derived));
+        (void)size;
+        return BlockCache<sizeof(Derived), alignof(Derived)>::allocate();
+    }
+
+    static void operator delete(void* p) noexcept
+    {
+        BlockCache<sizeof(Derived), alignof(Derived)>::deallocate(p);
+    }
+};
+
+// Stands for the value of a Future<void>.
+struct Unit {};
+
+template<typename T>
+class SharedState : public Recycled<SharedState<T>> {
+public:
+    using Value = std::conditional_t<std::is_void_v<T>, Unit, T>;
+
+    explicit SharedState(const Executor& executor) noexcept : executor_(executor) {}
+
+    const Executor& executor() const noexcept
+    {
+        return executor_;
+    }
+
+    void add_ref() noexcept
+    {
+        refs_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void release() noexcept
+    {
+        if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) delete this;
+    }
+
+    template<typename... Args>
+    void set_value(Args&&... args)
+    {
+        result_.template emplace<1>(std::forward<Args>(args)...);
+        complete();
+    }
+
+    void set_exception(std::exception_ptr e) noexcept
+    {
+        result_.template emplace<2>(std::move(e));
+        complete();
+    }
+
+    bool is_ready() const noexcept
+    {
+        return cont_.load(std::memory_order_acquire) == done();
+    }
+
+    // Run `c` once the result is in, or right away if it already is. At most one continuation at a time.
+    void subscribe(Continuation* c) noexcept
+    {
+        Continuation* expected = nullptr;
+        if (!cont_.compare_exchange_strong(expected, c, std::memory_order_acq_rel, std::memory_order_acquire)) {
+            assert(expected == done());
+            c->executor.post(c);
+        }
+    }
+
+    // The accessors below are only valid once the result is in.
+
+    bool has_exception() const noexcept
+    {
+        return result_.index() == 2;
+    }
+
+    const std::exception_ptr& exception() const noexcept
+    {
+        return std::get<2>(result_);
+    }
+
+    Value& value() noexcept
+    {
+        return std::get<1>(result_);
+    }
+
+    // Rethrows the exception, if any.
+    Value take()
+    {
+        if (has_exception()) std::rethrow_exception(exception());
+        return std::move(value());
+    }
+
+private:
+    Executor                                                 executor_;
+    std::atomic<std::uint32_t>                               refs_{1};
+    std::atomic<Continuation*>                               cont_{nullptr};
+    std::variant<std::monostate, Value, std::exception_ptr> result_;
+
+    // Marks a completed state in place of the continuation.
+    static Continuation* done() noexcept
+    {
+        return reinterpret_cast<Continuation*>(std::uintptr_t(1));
+    }
+
+    void complete() noexcept
+    {
+        auto* const c = cont_.exchange(done(), std::memory_order_acq_rel);
+        if (c) c->executor.post(c);
+    }
+};
+
+// Store the result of f(args...) into `state`.
+template<typename T, typename F, typename... Args>
+void
+fulfil(SharedState<T>& state, F& f, Args&&... args) noexcept
+{
+    try {
+        if constexpr (std::is_void_v<T>) {
+            std::invoke(f, std::forward<Args>(args)...);
+            state.set_value();
+        } else {
+            state.set_value(std::invoke(f, std::forward<Args>(args)...));
+        }
+    } catch (...) {
+        state.set_exception(std::current_exception());
+    }
+}
+
+// Pool task for async(). Breaks the promise if dropped unrun.
+template<typename T, typename F>
+class AsyncJob {
+public:
+    template<typename G>
+    AsyncJob(SharedState<T>* state, G&& f) : state_(state), f_(std::forward<G>(f))
+    {}
+
+    AsyncJob(AsyncJob&& other) noexcept(std::is_nothrow_move_constructible_v<F>)
+    : state_(std::exchange(other.state_, nullptr)), f_(std::move(other.f_))
+    {}
+    AsyncJob& operator=(AsyncJob&&) = delete;
+
+    ~AsyncJob()
+    {
+        if (state_) {
+            state_->set_exception(broken_promise());
+            state_->release();
+        }
+    }
+
+    void operator()() noexcept
+    {
+        fulfil(*state_, f_);
+        std::exchange(state_, nullptr)->release();
+    }
+
+private:
+    SharedState<T>* state_;
+    F               f_;
+};
+
+template<typename T, typename F>
+struct ThenResult {
+    using type = std::invoke_result_t<F, T&&>;
+};
+template<typename F>
+struct ThenResult<void, F> {
+    using type = std::invoke_result_t<F>;
+};
+
+template<typename T, typename U, typename F>
+class ThenNode final : public Continuation, public Recycled<ThenNode<T, U, F>> {
+public:
+    template<typename G>
+    ThenNode(SharedState<T>* input, SharedState<U>* output, G&& f)
+    : input_(input), output_(output), f_(std::forward<G>(f))
+    {
+        executor = input->executor();
+    }
+
+    void run() noexcept override
+    {
+        if (input_->has_exception()) {
+            output_->set_exception(input_->exception());
+        } else if constexpr (std::is_void_v<T>) {
+            fulfil(*output_, f_);
+        } else {
+            fulfil(*output_, f_, std::move(input_->value()));
+        }
+        finish();
+    }
+
+    void cancel() noexcept override
+    {
+        output_->set_exception(broken_promise());
+        finish();
+    }
+
+private:
+    SharedState<T>* input_;
+    SharedState<U>* output_;
+    F               f_;
+
+    void finish() noexcept
+    {
+        input_->release();
+        output_->release();
+        delete this;
+    }
+};
+
+// Blocks a thread until the result is in. Lives on the stack of the waiting thread.
+class Waiter final : public Continuation {
+public:
+    void run() noexcept override
+    {
+        // We may be gone as soon as fired_ is set, and so may the waiting thread, with its parker: Hold a reference.
+        const auto parker = parker_;
+        fired_.store(true, std::memory_order_release);
+        parker->unpark();
+    }
+
+    void cancel() noexcept override
+    {
+        run(); // Never posted
+    }
+
+    // On a worker of `pool`, help with its tasks while waiting. Other threads just block.
+    void wait(const Executor& pool)
+    {
+        const bool helping = pool.can_help();
+        while (!fired_.load(std::memory_order_acquire)) {
+            if (!helping) {
+                parker_->park();
+            } else if (!pool.help()) {
+                // New tasks don't wake us up, so don't block for long.
+                parker_->park_until(std::chrono::steady_clock::now() + std::chrono::microseconds(100));
+            }
+        }
+    }
+
+private:
+    // Per thread, and shared with run(), since it must outlive the Waiter. A stale wake-up only costs another check
+    // of fired_.
+    static const std::shared_ptr<Parker<BlockingWait>>& local_parker()
+    {
+        thread_local const auto parker = std::make_shared<Parker<BlockingWait>>();
+        return parker;
+    }
+
+    std::shared_ptr<Parker<BlockingWait>> parker_ = local_parker();
+    std::atomic<bool>     fired_{false};
+};
+
+struct FutureAccess {
+    template<typename T>
+    static Future<T> make(SharedState<T>* state) noexcept
+    {
+        return Future<T>(state);
+    }
+
+    template<typename T>
+    static SharedState<T>* release(Future<T>& fut) noexcept
+    {
+        assert(fut.valid());
+        return std::exchange(fut.state_, nullptr);
+    }
+};
+
+} // namespace detail
+
+template<typename Pool>
+inline void
+Executor::post_to(void* pool, detail::Continuation* c) noexcept
+{
+    try {
+        static_cast<Pool*>(pool)->enqueue(detail::ContinuationJob(c));
+    } catch (...) {
+        // The job cancelled `c` on its way out. Nothing more to do.
+    }
+}
+
+inline void
+Executor::post(detail::Continuation* c) const noexcept
+{
+    if (post_) {
+        post_(pool_, c);
+    } else {
+        c->run();
+    }
+}
+
+/**
+ * Result of an asynchronous operation. Move-only, with a single consumer.
+ */
+template<typename T>
+class Future {
+public:
+    using value_type = T;
+
+    Future() noexcept = default;
+
+    Future(Future&& other) noexcept : state_(std::exchange(other.state_, nullptr)) {}
+
+    Future& operator=(Future&& other) noexcept
+    {
+        if (this != &other) {
+            reset();
+            state_ = std::exchange(other.state_, nullptr);
+        }
+        return *this;
+    }
+
+    ~Future()
+    {
+        reset();
+    }
+
+    // Whether this refers to a result, i.e. get() and then() haven't been called yet.
+    bool valid() const noexcept
+    {
+        return state_ != nullptr;
+    }
+
+    bool is_ready() const noexcept
+    {
+        assert(valid());
+        return state_->is_ready();
+    }
+
+    /**
+     * Block until the result is in. Called from a worker of the pool, it runs pending tasks meanwhile,
+     * so that waiting doesn't take the worker away from the pool.
+     */
+    void wait() const
+    {
+        assert(valid());
+        if (state_->is_ready()) return;
+        detail::Waiter waiter;
+        state_->subscribe(&waiter);
+        waiter.wait(state_->executor());
+    }
+
+    // Wait for the result, and take it. Rethrows the exception, if any.
+    T get()
+    {
+        wait();
+        auto* const state = std::exchange(state_, nullptr);
+        if constexpr (std::is_void_v<T>) {
+            struct Release {
+                detail::SharedState<T>* state;
+                ~Release() { state->release(); }
+            } guard{state};
+            state->take();
+        } else {
+            std::optional<T> ret;
+            try {
+                ret.emplace(state->take());
+            } catch (...) {
+                state->release();
+                throw;
+            }
+            state->release();
+            return std::move(*ret);
+        }
+    }
+
+    /**
+     * Run `f` on the pool with the result, once it is in, and get a Future for what `f` returns.
+     * `f` takes a T&&, or nothing for Future<void>. If this holds an exception, `f` is skipped,
+     * and the returned Future holds the same exception.
+     */
+    template<typename F>
+    auto then(F&& f) -> Future<typename detail::ThenResult<T, std::decay_t<F>&>::type>
+    {
+        using U = typename detail::ThenResult<T, std::decay_t<F>&>::type;
+        auto* const input  = detail::FutureAccess::release(*this);
+        auto* const output = new detail::SharedState<U>(input->executor());
+        output->add_ref();
+        try {
+            input->subscribe(new detail::ThenNode<T, U, std::decay_t<F>>(input, output, std::forward<F>(f)));
+        } catch (...) {
+            input->release();
+            output->release();
+            output->release();
+            throw;
+        }
+        return detail::FutureAccess::make(output);
+    }
+
+private:
+    detail::SharedState<T>* state_ = nullptr;
+
+    explicit Future(detail::SharedState<T>* state) noexcept : state_(state) {}
+
+    void reset() noexcept
+    {
+        if (state_) std::exchange(state_, nullptr)->release();
+    }
+
+    friend struct detail::FutureAccess;
+};
+
+/**
+ * Producer side of a Future. Destroying a Promise before setting it stores a std::future_error (broken_promise).
+ */
+template<typename T>
+class Promise {
+public:
+    // Continuations of the future run on `executor`.
+    explicit Promise(const Executor& executor = {}) : state_(new detail::SharedState<T>(executor)) {}
+
+    Promise(Promise&& other) noexcept
+    : state_(std::exchange(other.state_, nullptr)), retrieved_(other.retrieved_), satisfied_(other.satisfied_)
+    {}
+    Promise& operator=(Promise&&) = delete;
+
+    ~Promise()
+    {
+        if (state_) {
+            if (!satisfied_) state_->set_exception(detail::broken_promise());
+            state_->release();
+        }
+    }
+
+    // Can only be called once.
+    Future<T> get_future() noexcept
+    {
+        assert(!retrieved_);
+        retrieved_ = true;
+        state_->add_ref();
+        return detail::FutureAccess::make(state_);
+    }
+
+    // Can only be called once, as can set_exception().
+    template<typename... Args>
+    void set_value(Args&&... args)
+    {
+        assert(!satisfied_);
+        state_->set_value(std::forward<Args>(args)...);
+        satisfied_ = true;
+    }
+
+    void set_exception(std::exception_ptr e) noexcept
+    {
+        assert(!satisfied_);
+        state_->set_exception(std::move(e));
+        satisfied_ = true;
+    }
+
+private:
+    detail::SharedState<T>* state_;
+    bool                    retrieved_ = false;
+    bool                    satisfied_ = false;
+};
+
+/**
+ * Run `f` on `pool`, a ThreadPool<void>. Continuations of the returned Future run on the same pool.
+ * Throws Pool::EnqueueBlocked if the pool has been stopped. If the task is dropped by stop_now(),
+ * the Future holds a std::future_error (broken_promise).
+ */
+template<typename Pool, typename F>
+auto
+async(Pool& pool, F&& f) -> Future<std::invoke_result_t<std::decay_t<F>&>>
+{
+    using R = std::invoke_result_t<std::decay_t<F>&>;
+    auto* const state = new detail::SharedState<R>(Executor(pool));
+    state->add_ref();
+    auto ret = detail::FutureAccess::make(state);
+    pool.enqueue(detail::AsyncJob<R, std::decay_t<F>>(state, std::forward<F>(f)));
+    return ret;
+}
+
+namespace detail {
+
+template<typename T>
+std::vector<SharedState<T>*>
+take_states(std::vector<Future<T>>& futures) noexcept
+{
+    std::vector<SharedState<T>*> ret;
+    ret.reserve(futures.size());
+    for (auto& fut : futures) ret.push_back(FutureAccess::release(fut));
+    return ret;
+}
+
+template<typename T>
+using WhenAllResult = std::conditional_t<std::is_void_v<T>, void, std::vector<T>>;
+
+template<typename T>
+class WhenAllNode {
+public:
+    using Result = WhenAllResult<T>;
+
+    WhenAllNode(std::vector<SharedState<T>*>&& inputs, SharedState<Result>* output)
+    : output_(output), slots_(inputs.size()), remaining_(inputs.size())
+    {
+        if constexpr (!std::is_void_v<T>) values_.resize(inputs.size());
+        for (std::size_t i = 0; i < inputs.size(); ++i) {
+            slots_[i].node  = this;
+            slots_[i].index = i;
+            slots_[i].input = inputs[i];
+        }
+    }
+
+    // We may be deleted as soon as the last input completes.
+    static void start(WhenAllNode* node) noexcept
+    {
+        const auto n     = node->slots_.size();
+        auto* const slot = node->slots_.data();
+        for (std::size_t i = 0; i < n; ++i) {
+            slot[i].input->subscribe(&slot[i]);
+        }
+    }
+
+private:
+    struct Slot final : Continuation {
+        WhenAllNode*    node;
+        std::size_t     index;
+        SharedState<T>* input;
+
+        void run() noexcept override
+        {
+            node->complete(*this);
+        }
+
+        void cancel() noexcept override
+        {
+            run(); // Never posted
+        }
+    };
+
+    using Values = std::conditional_t<std::is_void_v<T>, Unit, std::vector<std::optional<T>>>;
+
+    SharedState<Result>*     output_;
+    std::vector<Slot>        slots_;
+    Values                   values_;
+    std::exception_ptr       error_;
+    std::atomic<bool>        failed_{false};
+    std::atomic<std::size_t> remaining_;
+
+    void complete(Slot& slot) noexcept
+    {
+        if (slot.input->has_exception()) {
+            if (!failed_.exchange(true)) error_ = slot.input->exception();
+        } else if constexpr (!std::is_void_v<T>) {
+            try {
+                values_[slot.index].emplace(std::move(slot.input->value()));
+            } catch (...) {
+                if (!failed_.exchange(true)) error_ = std::current_exception();
+            }
+        }
+        slot.input->release();
+        if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1) finish();
+    }
+
+    void finish() noexcept
+    {
+        if (error_) {
+            output_->set_exception(error_);
+        } else if constexpr (std::is_void_v<T>) {
+            output_->set_value();
+        } else {
+            try {
+                std::vector<T> ret;
+                ret.reserve(values_.size());
+                for (auto& v : values_) ret.push_back(std::move(*v));
+                output_->set_value(std::move(ret));
+            } catch (...) {
+                output_->set_exception(std::current_exception());
+            }
+        }
+        output_->release();
+        delete this;
+    }
+};
+
+} // namespace detail
+
+/**
+ * Value of the future returned by when_any(): Which input completed first, and its value.
+ */
+template<typename T>
+struct WhenAnyResult {
+    std::size_t index;
+    T           value;
+};
+
+namespace detail {
+
+template<typename T>
+using WhenAnyResultT = std::conditional_t<std::is_void_v<T>, std::size_t, WhenAnyResult<T>>;
+
+template<typename T>
+class WhenAnyNode {
+public:
+    using Result = WhenAnyResultT<T>;
+
+    WhenAnyNode(std::vector<SharedState<T>*>&& inputs, SharedState<Result>* output)
+    : output_(output), slots_(inputs.size()), remaining_(inputs.size())
+    {
+        for (std::size_t i = 0; i < inputs.size(); ++i) {
+            slots_[i].node  = this;
+            slots_[i].index = i;
+            slots_[i].input = inputs[i];
+        }
+    }
+
+    static void start(WhenAnyNode* node) noexcept
+    {
+        const auto n     = node->slots_.size();
+        auto* const slot = node->slots_.data();
+        for (std::size_t i = 0; i < n; ++i) {
+            slot[i].input->subscribe(&slot[i]);
+        }
+    }
+
+private:
+    struct Slot final : Continuation {
+        WhenAnyNode*    node;
+        std::size_t     index;
+        SharedState<T>* input;
+
+        void run() noexcept override
+        {
+            node->complete(*this);
+        }
+
+        void cancel() noexcept override
+        {
+            run(); // Never posted
+        }
+    };
+
+    SharedState<Result>*     output_;
+    std::vector<Slot>        slots_;
+    std::atomic<bool>        won_{false};
+    std::atomic<std::size_t> remaining_;
+
+    void complete(Slot& slot) noexcept
+    {
+        if (!won_.exchange(true)) {
+            if (slot.input->has_exception()) {
+                output_->set_exception(slot.input->exception());
+            } else if constexpr (std::is_void_v<T>) {
+                output_->set_value(slot.index);
+            } else {
+                try {
+                    output_->set_value(Result{slot.index, std::move(slot.input->value())});
+                } catch (...) {
+                    output_->set_exception(std::current_exception());
+                }
+            }
+        }
+        slot.input->release();
+        if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            output_->release();
+            delete this;
+        }
+    }
+};
+
+} // namespace detail
+
+/**
+ * Future for the values of all futures in [first, last), in order: A std::vector<T>, or nothing for Future<void>.
+ * Holds the first exception to come in, if any. The futures are consumed.
+ */
+template<typename It>
+auto
+when_all(It first, It last)
+{
+    using T      = typename std::iterator_traits<It>::value_type::value_type;
+    using Result = detail::WhenAllResult<T>;
+
+    std::vector<Future<T>> futures;
+    for (; first != last; ++first) futures.push_back(std::move(*first));
+    auto inputs = detail::take_states(futures);
+
+    auto* const output = new detail::SharedState<Result>(inputs.empty() ? Executor{} : inputs[0]->executor());
+    auto        ret    = detail::FutureAccess::make(output);
+    if (inputs.empty()) {
+        output->set_value();
+        return ret;
+    }
+    output->add_ref();
+    detail::WhenAllNode<T>::start(new detail::WhenAllNode<T>(std::move(inputs), output));
+    return ret;
+}
+
+/**
+ * Future for the first of the futures in [first, last) to complete: A WhenAnyResult<T> with its index and value,
+ * or only the index for Future<void>. Holds its exception instead, if it has one. The range must not be empty,
+ * and the futures are consumed.
+ */
+template<typename It>
+auto
+when_any(It first, It last)
+{
+    using T      = typename std::iterator_traits<It>::value_type::value_type;
+    using Result = detail::WhenAnyResultT<T>;
+
+    std::vector<Future<T>> futures;
+    for (; first != last; ++first) futures.push_back(std::move(*first));
+    assert(!futures.empty());
+    auto inputs = detail::take_states(futures);
+
+    auto* const output = new detail::SharedState<Result>(inputs[0]->executor());
+    auto        ret    = detail::FutureAccess::make(output);
+    output->add_ref();
+    detail::WhenAnyNode<T>::start(new detail::WhenAnyNode<T>(std::move(inputs), output));
+    return ret;
+}
+
+} // namespace clst
+
+#endif // CLST_FUTURE_HPP
@@ -0,0 +1,160 @@
+#ifndef CLST_MOVE_ONLY_FUNCTION_HPP
+#define CLST_MOVE_ONLY_FUNCTION_HPP
+
+#include <cstddef>
+#include <functional> // std::invoke
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace clst {
+
+/**
+ * Move-only, type-erased callable wrapper, similar to C++23 std::move_only_function.
+ *
+ * Callables up to `BufferSize` bytes (and no stricter alignment than max_align_t) are stored inline,
+ * if they're nothrow move constructible. Larger callables are heap-allocated.
+ * The default buffer size makes the whole object 64 bytes (on 64-bit platforms).
+ */
+template<typename Signature, std::size_t BufferSize = 56>
+class MoveOnlyFunction;
+
+template<typename R, typename... Args, std::size_t BufferSize>
+class MoveOnlyFunction<R(Args...), BufferSize> {
+    static_assert(BufferSize >= sizeof(void*));
+
+public:
+    // Whether a callable of type F is stored without heap allocation.
+    template<typename F>
+    static constexpr bool stores_inline = sizeof(F) <= BufferSize && alignof(F) <= alignof(std::max_align_t) &&
+                                          std::is_nothrow_move_constructible_v<F>;
+
+    MoveOnlyFunction() noexcept = default;
+    MoveOnlyFunction(std::nullptr_t) noexcept {}
+
+    template<typename F, typename Fd = std::decay_t<F>,
+             typename = std::enable_if_t<!std::is_same_v<Fd, MoveOnlyFunction> && std::is_invocable_r_v<R, Fd&, Args...>>>
+    MoveOnlyFunction(F&& f)
+    {
+        if constexpr (stores_inline<Fd>) {
+            ::new (static_cast<void*>(buf_)) Fd(std::forward<F>(f));
+        } else {
+            ::new (static_cast<void*>(buf_)) Fd*(new Fd(std::forward<F>(f)));
+        }
+        vtable_ = &vtable_for<Fd>;
+    }
+
+    MoveOnlyFunction(MoveOnlyFunction&& rhs) noexcept : vtable_(rhs.vtable_)
+    {
+        if (vtable_) {
+            vtable_->relocate(buf_, rhs.buf_);
+            rhs.vtable_ = nullptr;
+        }
+    }
+
+    MoveOnlyFunction& operator=(MoveOnlyFunction&& rhs) noexcept
+    {
+        if (this != &rhs) {
+            reset();
+            if (rhs.vtable_) {
+                rhs.vtable_->relocate(buf_, rhs.buf_);
+                vtable_     = rhs.vtable_;
+                rhs.vtable_ = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    MoveOnlyFunction& operator=(std::nullptr_t) noexcept
+    {
+        reset();
+        return *this;
+    }
+
+    ~MoveOnlyFunction()
+    {
+        reset();
+    }
+
+    // Not copiable.
+    MoveOnlyFunction(const MoveOnlyFunction&) = delete;
+    MoveOnlyFunction& operator=(const MoveOnlyFunction&) = delete;
+
+    explicit operator bool() const noexcept
+    {
+        return vtable_ != nullptr;
+    }
+
+    // UB if empty.
+    R operator()(Args... args)
+    {
+        return vtable_->invoke(buf_, std::forward<Args>(args)...);
+    }
+
+private:
+    struct VTable {
+        R (*invoke)(void* storage, Args&&... args);
+        void (*relocate)(void* dst, void* src) noexcept; // move-construct into dst, then destroy src
+        void (*destroy)(void* storage) noexcept;
+    };
+
+    template<typename Fd>
+    static Fd& target(void* storage) noexcept
+    {
+        if constexpr (stores_inline<Fd>) {
+            return *std::launder(static_cast<Fd*>(storage));
+        } else {
+            return **std::launder(static_cast<Fd**>(storage));
+        }
+    }
+
+    template<typename Fd>
+    static R invoke_impl(void* storage, Args&&... args)
+    {
+        if constexpr (std::is_void_v<R>) {
+            std::invoke(target<Fd>(storage), std::forward<Args>(args)...);
+        } else {
+            return std::invoke(target<Fd>(storage), std::forward<Args>(args)...);
+        }
+    }
+
+    template<typename Fd>
+    static void relocate_impl(void* dst, void* src) noexcept
+    {
+        if constexpr (stores_inline<Fd>) {
+            auto& f = target<Fd>(src);
+            ::new (dst) Fd(std::move(f));
+            f.~Fd();
+        } else {
+            ::new (dst) Fd*(&target<Fd>(src)); // Steal the pointer
+        }
+    }
+
+    template<typename Fd>
+    static void destroy_impl(void* storage) noexcept
+    {
+        if constexpr (stores_inline<Fd>) {
+            target<Fd>(storage).~Fd();
+        } else {
+            delete &target<Fd>(storage);
+        }
+    }
+
+    template<typename Fd>
+    static constexpr VTable vtable_for = {&invoke_impl<Fd>, &relocate_impl<Fd>, &destroy_impl<Fd>};
+
+    void reset() noexcept
+    {
+        if (vtable_) {
+            vtable_->destroy(buf_);
+            vtable_ = nullptr;
+        }
+    }
+
+    alignas(std::max_align_t) unsigned char buf_[BufferSize];
+    const VTable* vtable_ = nullptr;
+};
+
+} // namespace clst
+
+#endif // CLST_MOVE_ONLY_FUNCTION_HPP
@@ -0,0 +1,281 @@
+#ifndef CLST_PARALLEL_HPP
+#define CLST_PARALLEL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "clst/detail/cache_line.hpp"
+
+/**
+ * Parallel range algorithms on top of clst::ThreadPool.
+ *
+ * The calling thread always takes part in the work, so these can be called from inside pool tasks
+ * (and on a saturated pool) without deadlocking. Helper tasks that start late simply find nothing left to do.
+ * The pool must have ReturnType void.
+ */
+
+namespace clst {
+
+// How to split a range into chunks.
+struct Partition {
+    enum Kind {
+        Static,  // One equally-sized chunk per participant (at least `grain` elements)
+        Dynamic, // Chunks of exactly `grain` elements
+        Guided,  // Chunks shrinking with the remaining work, but at least `grain` elements
+    };
+
+    Kind        kind  = Guided;
+    std::size_t grain = 1;
+};
+
+namespace detail {
+
+template<typename Body>
+class ParallelLoop {
+public:
+    ParallelLoop(std::size_t n, Partition part, std::size_t nb_participants, Body&& body)
+    : n_(n), part_(part), nb_participants_(nb_participants), body_(std::move(body))
+    {
+        if (part_.grain == 0) part_.grain = 1;
+        if (part_.kind == Partition::Static) {
+            part_.grain = std::max(part_.grain, (n_ + nb_participants_ - 1) / nb_participants_);
+        }
+    }
+
+    // Process chunks until none are left.
+    void run(std::size_t participant) noexcept
+    {
+        std::size_t begin, end;
+        while (claim(begin, end)) {
+            if (!failed_.load(std::memory_order_relaxed)) {
+                try {
+                    body_(begin, end, participant);
+                } catch (...) {
+                    std::scoped_lock lk(mutex_);
+                    if (!error_) error_ = std::current_exception();
+                    failed_.store(true, std::memory_order_relaxed);
+                }
+            }
+            if (done_.fetch_add(end - begin, std::memory_order_acq_rel) + (end - begin) == n_) {
+                {
+                    std::scoped_lock lk(mutex_);
+                }
+                cond_.notify_all();
+            }
+        }
+    }
+
+    // Wait for claimed chunks to finish, then rethrow the first exception if any.
+    void wait()
+    {
+        if (done_.load(std::memory_order_acquire) != n_) {
+            std::unique_lock lk(mutex_);
+            cond_.wait(lk, [&] { return done_.load(std::memory_order_acquire) == n_; });
+        }
+        if (error_) std::rethrow_exception(error_);
+    }
+
+private:
+    bool claim(std::size_t& begin, std::size_t& end) noexcept
+    {
+        if (part_.kind != Partition::Guided) {
+            begin = next_.fetch_add(part_.grain, std::memory_order_relaxed);
+            if (begin >= n_) return false;
+            end = std::min(n_, begin + part_.grain);
+            return true;
+        }
+        begin = next_.load(std::memory_order_relaxed);
+        do {
+            if (begin >= n_) return false;
+            const auto chunk = std::max(part_.grain, (n_ - begin) / (2 * nb_participants_));
+            end              = std::min(n_, begin + chunk);
+        } while (!next_.compare_exchange_weak(begin, end, std::memory_order_relaxed));
+        return true;
+    }
+
+    const std::size_t n_;
+    Partition         part_;
+    const std::size_t nb_participants_;
+    Body              body_;
+
+    alignas(cache_line_size) std::atomic<std::size_t> next_{0};
+    alignas(cache_line_size) std::atomic<std::size_t> done_{0};
+    std::atomic<bool>       failed_{false};
+    std::exception_ptr      error_;
+    std::mutex              mutex_;
+    std::condition_variable cond_;
+};
+
+// Run body(begin, end, participant) over [0, n) on the pool and the calling thread.
+// Participant 0 is the calling thread, helpers are numbered from 1 to nb_participants - 1.
+template<typename Pool, typename Body>
+void
+parallel_run(Pool& pool, std::size_t n, Partition part, std::size_t nb_participants, Body&& body)
+{
+    static_assert(std::is_void_v<typename Pool::ReturnType>, "Parallel algorithms require a ThreadPool<void>");
+    if (n == 0) return;
+
+    using Loop = ParallelLoop<std::decay_t<Body>>;
+    // Shared with the helpers, since they may start after we've returned.
+    auto loop = std::make_shared<Loop>(n, part, nb_participants, std::forward<Body>(body));
+
+    const auto nb_chunks  = (n + std::max<std::size_t>(part.grain, 1) - 1) / std::max<std::size_t>(part.grain, 1);
+    const auto nb_helpers = std::min(nb_participants - 1, nb_chunks - 1);
+    // Never block on a full queue: We may be holding a chunk of an outer loop, and so may the workers that would drain it.
+    for (std::size_t i = 1; i <= nb_helpers; ++i) {
+        if (!pool.try_enqueue([loop, i] { loop->run(i); })) break; // Full or stopped: Do it ourselves
+    }
+    loop->run(0);
+    loop->wait();
+}
+
+template<typename Pool>
+std::size_t
+nb_participants(const Pool& pool) noexcept
+{
+    return pool.size() + 1;
+}
+
+template<typename T>
+struct alignas(cache_line_size) PaddedPartial {
+    std::optional<T> value;
+};
+
+} // namespace detail
+
+/**
+ * Call f(i) for every i in [first, last).
+ */
+template<typename Pool, typename Index, typename F>
+void
+parallel_for(Pool& pool, Index first, Index last, F&& f, Partition part = {})
+{
+    if (!(first < last)) return;
+    const auto n = static_cast<std::size_t>(last - first);
+    detail::parallel_run(pool, n, part, detail::nb_participants(pool), [first, &f](std::size_t b, std::size_t e, std::size_t) {
+        for (auto i = b; i < e; ++i) {
+            f(static_cast<Index>(first + static_cast<Index>(i)));
+        }
+    });
+}
+
+/**
+ * Parallel std::transform. Writes op(*it) to the corresponding position of d_first.
+ */
+template<typename Pool, typename RandomIt, typename OutputIt, typename UnaryOp>
+OutputIt
+parallel_transform(Pool& pool, RandomIt first, RandomIt last, OutputIt d_first, UnaryOp op, Partition part = {})
+{
+    const auto n = static_cast<std::size_t>(std::distance(first, last));
+    detail::parallel_run(pool, n, part, detail::nb_participants(pool), [&](std::size_t b, std::size_t e, std::size_t) {
+        auto out = d_first + static_cast<std::ptrdiff_t>(b);
+        for (auto it = first + static_cast<std::ptrdiff_t>(b); it != first + static_cast<std::ptrdiff_t>(e); ++it, ++out) {
+            *out = op(*it);
+        }
+    });
+    return d_first + static_cast<std::ptrdiff_t>(n);
+}
+
+/**
+ * Parallel std::transform_reduce.
+ * As with std::reduce, the result is non-deterministic if `reduce` isn't associative and commutative.
+ */
+template<typename Pool, typename RandomIt, typename T, typename BinaryOp, typename UnaryOp>
+T
+parallel_transform_reduce(Pool& pool, RandomIt first, RandomIt last, T init, BinaryOp reduce, UnaryOp transform, Partition part = {})
+{
+    const auto n               = static_cast<std::size_t>(std::distance(first, last));
+    const auto nb_participants = detail::nb_participants(pool);
+    std::vector<detail::PaddedPartial<T>> partials(nb_participants);
+
+    detail::parallel_run(pool, n, part, nb_participants, [&](std::size_t b, std::size_t e, std::size_t p) {
+        auto& acc = partials[p].value;
+        auto  it  = first + static_cast<std::ptrdiff_t>(b);
+        if (!acc) {
+            acc.emplace(transform(*it));
+            ++it;
+        }
+        for (; it != first + static_cast<std::ptrdiff_t>(e); ++it) {
+            *acc = reduce(std::move(*acc), transform(*it));
+        }
+    });
+
+    for (auto& partial : partials) {
+        if (partial.value) init = reduce(std::move(init), std::move(*partial.value));
+    }
+    return init;
+}
+
+/**
+ * Parallel std::reduce.
+ * As with std::reduce, the result is non-deterministic if `op` isn't associative and commutative.
+ */
+template<typename Pool, typename RandomIt, typename T, typename BinaryOp>
+T
+parallel_reduce(Pool& pool, RandomIt first, RandomIt last, T init, BinaryOp op, Partition part = {})
+{
+    return parallel_transform_reduce(
+        pool, first, last, std::move(init), std::move(op), [](const auto& x) -> decltype(auto) { return x; }, part);
+}
+
+/**
+ * Parallel std::inclusive_scan. `op` must be associative.
+ *
+ * Runs in three phases: chunk totals (parallel), scan of the totals (serial), chunk scans (parallel).
+ * The partition only controls the minimal chunk size, chunks are always equally sized.
+ */
+template<typename Pool, typename RandomIt, typename OutputIt, typename BinaryOp>
+OutputIt
+parallel_scan(Pool& pool, RandomIt first, RandomIt last, OutputIt d_first, BinaryOp op, Partition part = {})
+{
+    using T = typename std::iterator_traits<RandomIt>::value_type;
+
+    const auto n = static_cast<std::size_t>(std::distance(first, last));
+    if (n == 0) return d_first;
+    const auto nb_participants = detail::nb_participants(pool);
+    // A few chunks per participant for load balancing.
+    const auto chunk     = std::max(std::max<std::size_t>(part.grain, 1), (n + 4 * nb_participants - 1) / (4 * nb_participants));
+    const auto nb_chunks = (n + chunk - 1) / chunk;
+    const auto chunks    = Partition{Partition::Dynamic, chunk};
+
+    std::vector<std::optional<T>> totals(nb_chunks);
+    detail::parallel_run(pool, n, chunks, nb_participants, [&](std::size_t b, std::size_t e, std::size_t) {
+        auto it  = first + static_cast<std::ptrdiff_t>(b);
+        T    acc = *it;
+        for (++it; it != first + static_cast<std::ptrdiff_t>(e); ++it) {
+            acc = op(std::move(acc), *it);
+        }
+        totals[b / chunk].emplace(std::move(acc));
+    });
+
+    // Prefix of the chunk totals, which is the carry-in of the next chunk. The first chunk has none.
+    for (std::size_t i = 1; i + 1 < nb_chunks; ++i) {
+        totals[i] = op(*totals[i - 1], std::move(*totals[i]));
+    }
+
+    detail::parallel_run(pool, n, chunks, nb_participants, [&](std::size_t b, std::size_t e, std::size_t) {
+        auto it  = first + static_cast<std::ptrdiff_t>(b);
+        auto out = d_first + static_cast<std::ptrdiff_t>(b);
+        const auto c = b / chunk;
+        T acc = c == 0 ? T(*it) : op(*totals[c - 1], *it);
+        *out  = acc;
+        for (++it, ++out; it != first + static_cast<std::ptrdiff_t>(e); ++it, ++out) {
+            acc  = op(std::move(acc), *it);
+            *out = acc;
+        }
+    });
+    return d_first + static_cast<std::ptrdiff_t>(n);
+}
+
+} // namespace clst
+
+#endif // CLST_PARALLEL_HPP
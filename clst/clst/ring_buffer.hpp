@@ -67,14 +67,14 @@ private:
     template<class V>
     bool push_impl(V&& value) {
         if (count_ == max_) return false;
-        alloc_traits::construct(alloc_(), data_() + (first_+count_)%max_, std::forward<V>(value));
+        alloc_traits::construct(alloc_(), data_() + wrap_(first_+count_), std::forward<V>(value));
         ++count_;
         return true;
     }
     template<class V>
     void push_overwrite_impl(V&& value) {
         if (count_ == max_) pop();
-        alloc_traits::construct(alloc_(), data_() + (first_+count_)%max_, std::forward<V>(value));
+        alloc_traits::construct(alloc_(), data_() + wrap_(first_+count_), std::forward<V>(value));
         ++count_;
     }
 
@@ -94,7 +94,7 @@ public:
     template <typename ...Args>
     auto& emplace(Args&& ...args) {
         if (count_ == max_) pop();
-        const auto ptr = data_() + (first_+count_) % max_;
+        const auto ptr = data_() + wrap_(first_+count_);
         alloc_traits::construct(alloc_(), ptr, std::forward<Args>(args)...);
         ++count_;
         return *ptr;
@@ -102,19 +102,19 @@ public:
 
     void pop() noexcept { // UB if empty
         alloc_traits::destroy(alloc_(), data_()+first_);
-        first_ = (first_+1) % max_;
+        first_ = wrap_(first_+1);
         --count_;
     }
     void pop_back() noexcept {
-        alloc_traits::destroy(alloc_(), data_() + (first_+count_-1) % max_);
+        alloc_traits::destroy(alloc_(), data_() + wrap_(first_+count_-1));
         --count_;
     }
 
     const auto& operator[](size_type i) const noexcept {
-        return data_()[(first_+i) % max_];
+        return data_()[wrap_(first_+i)];
     }
     auto& operator[](size_type i) noexcept {
-        return data_()[(first_+i) % max_];
+        return data_()[wrap_(first_+i)];
     }
     auto& at(size_type i) {
         if (i >= count_) throw std::out_of_range("RingBuffer subscription out of range");
@@ -134,16 +134,19 @@ public:
     size_type capacity() const noexcept { return max_; }
 
     void clear() noexcept {
-        for (auto i=first_; i<first_ + count_; ++i) {
-            alloc_traits::destroy(alloc_(), &data_()[i % max_]);
-            --count_;
+        for (size_type i=0; i<count_; ++i) {
+            alloc_traits::destroy(alloc_(), data_() + wrap_(first_+i));
         }
+        first_ = 0;
+        count_ = 0;
     }
 
 private:
     CompressPair<allocator_type, T*> alloc_and_data_;
     auto& alloc_() noexcept { return alloc_and_data_.first(); }
     auto data_() const noexcept { return alloc_and_data_.second(); }
+    // Position i < 2*max_ into the buffer. Cheaper than a modulo, which would be a division.
+    size_type wrap_(size_type i) const noexcept { return i < max_ ? i : i - max_; }
     size_type first_;
     size_type count_;
     size_type max_;
@@ -0,0 +1,328 @@
+#ifndef CLST_STOP_TOKEN_HPP
+#define CLST_STOP_TOKEN_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+/**
+ * Cooperative cancellation, after std::stop_source/std::stop_token/std::stop_callback of C++20.
+ *
+ * A StopSource requests a stop, which every StopToken obtained from it observes. Polling a token is a single
+ * atomic load, cheap enough to do in the inner loop of a task. Blocking calls that take a token (Channel::pop,
+ * Channel::emplace, ThreadPool::wait_all, ThreadPool::wait) return early once it is signalled.
+ *
+ * A StopCallback runs a callback when its token is signalled, or right away if it already was.
+ * Callbacks run on the thread that calls request_stop(). They must not throw.
+ */
+
+namespace clst {
+
+class StopSource;
+class StopToken;
+template<typename Callback>
+class StopCallback;
+
+namespace detail {
+
+struct StopCallbackBase {
+    StopCallbackBase*  next    = nullptr;
+    StopCallbackBase*  prev    = nullptr;
+    bool               linked  = false;
+    bool*              removed = nullptr; // Set by the callback destroying itself, while being invoked
+    std::atomic<bool>  done{false};       // Invocation finished
+    void (*invoke)(StopCallbackBase*) noexcept = nullptr;
+};
+
+// Shared by all sources, tokens and callbacks of one stop state.
+class StopState {
+public:
+    bool stop_requested() const noexcept
+    {
+        return requested_.load(std::memory_order_acquire);
+    }
+
+    bool stop_possible() const noexcept
+    {
+        return stop_requested() || sources_.load(std::memory_order_acquire) != 0;
+    }
+
+    void add_ref() noexcept
+    {
+        refs_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void release() noexcept
+    {
+        if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) delete this;
+    }
+
+    void add_source() noexcept
+    {
+        sources_.fetch_add(1, std::memory_order_relaxed);
+        add_ref();
+    }
+
+    void release_source() noexcept
+    {
+        sources_.fetch_sub(1, std::memory_order_release);
+        release();
+    }
+
+    bool request_stop() noexcept
+    {
+        {
+            std::scoped_lock lk(mutex_);
+            if (requested_.load(std::memory_order_relaxed)) return false;
+            requested_.store(true, std::memory_order_release);
+            invoker_ = std::this_thread::get_id();
+        }
+        for (;;) {
+            StopCallbackBase* cb;
+            bool              removed = false;
+            {
+                std::scoped_lock lk(mutex_);
+                cb = head_;
+                if (!cb) {
+                    running_ = nullptr;
+                    break;
+                }
+                unlink(cb);
+                running_     = cb;
+                cb->removed  = &removed;
+            }
+            cb->invoke(cb);
+            if (!removed) cb->done.store(true, std::memory_order_release); // cb may be gone right after this
+        }
+        return true;
+    }
+
+    // Returns false if the stop was already requested: Run the callback inline then.
+    bool add_callback(StopCallbackBase* cb) noexcept
+    {
+        std::scoped_lock lk(mutex_);
+        if (requested_.load(std::memory_order_relaxed)) return false;
+        cb->prev = nullptr;
+        cb->next = head_;
+        if (head_) head_->prev = cb;
+        head_      = cb;
+        cb->linked = true;
+        return true;
+    }
+
+    // Once this returns, the callback is not running, and won't ever be.
+    void remove_callback(StopCallbackBase* cb) noexcept
+    {
+        {
+            std::scoped_lock lk(mutex_);
+            if (cb->linked) {
+                unlink(cb);
+                return;
+            }
+            if (running_ != cb) return; // Never registered, or already done
+            if (invoker_ == std::this_thread::get_id()) {
+                // Destroyed from within its own callback.
+                *cb->removed = true;
+                return;
+            }
+        }
+        // Being invoked on another thread. Rare, and short.
+        while (!cb->done.load(std::memory_order_acquire)) std::this_thread::yield();
+    }
+
+private:
+    std::atomic<std::uint32_t> refs_{1};
+    std::atomic<std::uint32_t> sources_{1};
+    std::atomic<bool>          requested_{false};
+
+    std::mutex        mutex_;
+    StopCallbackBase* head_    = nullptr;
+    StopCallbackBase* running_ = nullptr;
+    std::thread::id   invoker_;
+
+    void unlink(StopCallbackBase* cb) noexcept
+    {
+        if (cb->prev) {
+            cb->prev->next = cb->next;
+        } else {
+            head_ = cb->next;
+        }
+        if (cb->next) cb->next->prev = cb->prev;
+        cb->linked = false;
+    }
+};
+
+} // namespace detail
+
+/**
+ * Observes the stop state of a StopSource. A default-constructed token is never signalled.
+ */
+class StopToken {
+public:
+    StopToken() noexcept = default;
+
+    StopToken(const StopToken& other) noexcept : state_(other.state_)
+    {
+        if (state_) state_->add_ref();
+    }
+
+    StopToken(StopToken&& other) noexcept : state_(std::exchange(other.state_, nullptr)) {}
+
+    StopToken& operator=(StopToken other) noexcept
+    {
+        swap(other);
+        return *this;
+    }
+
+    ~StopToken()
+    {
+        if (state_) state_->release();
+    }
+
+    void swap(StopToken& other) noexcept
+    {
+        std::swap(state_, other.state_);
+    }
+
+    bool stop_requested() const noexcept
+    {
+        return state_ && state_->stop_requested();
+    }
+
+    // False if a stop can never be requested: No state, or no StopSource left and no stop requested.
+    bool stop_possible() const noexcept
+    {
+        return state_ && state_->stop_possible();
+    }
+
+    friend bool operator==(const StopToken& a, const StopToken& b) noexcept
+    {
+        return a.state_ == b.state_;
+    }
+
+    friend bool operator!=(const StopToken& a, const StopToken& b) noexcept
+    {
+        return !(a == b);
+    }
+
+private:
+    friend class StopSource;
+    template<typename Callback>
+    friend class StopCallback;
+
+    detail::StopState* state_ = nullptr;
+
+    explicit StopToken(detail::StopState* state) noexcept : state_(state)
+    {
+        state_->add_ref();
+    }
+};
+
+/**
+ * Owns a stop state, shared with its copies.
+ */
+class StopSource {
+public:
+    StopSource() : state_(new detail::StopState) {}
+
+    StopSource(const StopSource& other) noexcept : state_(other.state_)
+    {
+        if (state_) state_->add_source();
+    }
+
+    StopSource(StopSource&& other) noexcept : state_(std::exchange(other.state_, nullptr)) {}
+
+    StopSource& operator=(StopSource other) noexcept
+    {
+        swap(other);
+        return *this;
+    }
+
+    ~StopSource()
+    {
+        if (state_) state_->release_source();
+    }
+
+    void swap(StopSource& other) noexcept
+    {
+        std::swap(state_, other.state_);
+    }
+
+    StopToken get_token() const noexcept
+    {
+        return state_ ? StopToken(state_) : StopToken();
+    }
+
+    /**
+     * Signal all tokens, and run the registered callbacks on this thread.
+     * Returns false if a stop had already been requested.
+     */
+    bool request_stop() noexcept
+    {
+        return state_ && state_->request_stop();
+    }
+
+    bool stop_requested() const noexcept
+    {
+        return state_ && state_->stop_requested();
+    }
+
+    bool stop_possible() const noexcept
+    {
+        return state_ != nullptr;
+    }
+
+private:
+    detail::StopState* state_;
+};
+
+/**
+ * Run `Callback` once a stop is requested on the token, for as long as this object lives.
+ *
+ * Once the destructor returns, the callback is not running, and won't be run: If it's being run on another
+ * thread, the destructor waits for it to finish.
+ */
+template<typename Callback>
+class StopCallback : private detail::StopCallbackBase {
+public:
+    template<typename C, typename = std::enable_if_t<std::is_constructible_v<Callback, C>>>
+    explicit StopCallback(const StopToken& token, C&& cb) noexcept(std::is_nothrow_constructible_v<Callback, C>)
+    : callback_(std::forward<C>(cb))
+    {
+        invoke = [](detail::StopCallbackBase* self) noexcept {
+            std::move(static_cast<StopCallback*>(self)->callback_)();
+        };
+        if (!token.stop_possible()) return;
+        if (token.state_->add_callback(this)) {
+            state_ = token.state_;
+            state_->add_ref();
+        } else {
+            std::move(callback_)();
+        }
+    }
+
+    ~StopCallback()
+    {
+        if (state_) {
+            state_->remove_callback(this);
+            state_->release();
+        }
+    }
+
+    StopCallback(const StopCallback&)            = delete;
+    StopCallback& operator=(const StopCallback&) = delete;
+
+private:
+    Callback           callback_;
+    detail::StopState* state_ = nullptr;
+};
+
+template<typename Callback>
+StopCallback(StopToken, Callback) -> StopCallback<Callback>;
+
+} // namespace clst
+
+#endif // CLST_STOP_TOKEN_HPP
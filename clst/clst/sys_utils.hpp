@@ -4,6 +4,7 @@
 #include <string>
 #include <filesystem>
 #include <cstddef>
+#include <vector>
 
 //FIXME: Use SystemError exceptions
 
@@ -19,6 +20,19 @@ struct MemoryInfo {
 
 MemoryInfo get_mem_info();
 
+struct CpuInfo {
+    unsigned id;      // logical CPU number, as used by the OS
+    unsigned core;    // physical core id, unique within a package
+    unsigned package; // physical package (socket) id
+};
+
+// Logical CPUs the calling thread may run on, sorted by id.
+// On Linux, topology comes from sysfs. Elsewhere, every CPU is reported as its own core.
+std::vector<CpuInfo> get_cpu_topology();
+
+// Pin the calling thread to a logical CPU. Linux only, throws SystemError on failure.
+void set_thread_affinity(unsigned cpu);
+
 } // namespace clst
 
 #endif // CLST_SYS_UTILS_HPP
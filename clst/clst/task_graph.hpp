@@ -0,0 +1,214 @@
+#ifndef CLST_TASK_GRAPH_HPP
+#define CLST_TASK_GRAPH_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "clst/move_only_function.hpp"
+
+namespace clst {
+
+/**
+ * A DAG of tasks, executed on a clst::ThreadPool<void>.
+ *
+ * Every node counts its unfinished predecessors. When a node finishes, it decrements the counters of its successors,
+ * and those that become ready are pushed onto the pool (one of them is continued on the current thread instead).
+ * No thread ever blocks on a dependency, nor on a full queue: A worker that can't push a node runs it inline.
+ *
+ * The graph can be run many times. A run only resets counters, so with a pool using InplaceTask storage,
+ * running a graph does not allocate. Except on a WorkStealing pool, where the nodes workers push are boxed:
+ * Workers recycle their boxes, so repeated runs only allocate while a worker pushes more nodes than it has taken.
+ *
+ * If a node throws, the bodies of all nodes not started yet are skipped, and wait() rethrows the first exception.
+ * The graph must be acyclic, and must not be modified while running.
+ */
+class TaskGraph {
+public:
+    using NodeId = std::size_t;
+
+    TaskGraph() = default;
+    ~TaskGraph() noexcept
+    {
+        std::unique_lock lk(mutex_);
+        cond_.wait(lk, [&] { return !running_; });
+    }
+
+    // Not copiable or movable: Running tasks refer to us.
+    TaskGraph(const TaskGraph&) = delete;
+    TaskGraph& operator=(const TaskGraph&) = delete;
+
+    template<typename F>
+    NodeId add(F&& f)
+    {
+        nodes_.emplace_back(std::forward<F>(f));
+        return nodes_.size() - 1;
+    }
+
+    // `before` must finish before `after` starts.
+    void precede(NodeId before, NodeId after)
+    {
+        assert(before < nodes_.size() && after < nodes_.size() && before != after);
+        nodes_[before].successors.push_back(after);
+        nodes_[after].nb_predecessors += 1;
+    }
+
+    std::size_t size() const noexcept
+    {
+        return nodes_.size();
+    }
+
+    /**
+     * Start executing the graph on `pool`. Returns immediately.
+     *
+     * Must not be called while a previous run is still in progress.
+     * If the pool refuses new tasks, the remaining nodes are executed on the thread that tries to push them.
+     * Nodes posted from this thread may block on a full queue.
+     */
+    template<typename Pool>
+    void run(Pool& pool);
+
+    /**
+     * Wait for the current run to finish. Rethrows the first exception thrown by a node.
+     */
+    void wait();
+
+private:
+    struct Node {
+        MoveOnlyFunction<void()> fn;
+        std::vector<NodeId>      successors;
+        std::size_t              nb_predecessors = 0;
+        std::atomic<std::size_t> pending{0};
+
+        template<typename F>
+        explicit Node(F&& f) : fn(std::forward<F>(f))
+        {}
+    };
+
+    static constexpr NodeId no_node = static_cast<NodeId>(-1);
+
+    std::deque<Node> nodes_; // Stable addresses, since Node isn't movable
+
+    // Type-erased handle to the pool of the current run.
+    void* pool_ = nullptr;
+    bool (*post_)(void* pool, TaskGraph* graph, NodeId id) = nullptr;
+
+    std::atomic<std::size_t> remaining_{0};
+    std::atomic<bool>        failed_{false};
+    std::exception_ptr       error_;
+    std::mutex               mutex_;
+    std::condition_variable  cond_;
+    bool                     running_ = false;
+
+    template<typename Pool>
+    static bool post_impl(void* pool, TaskGraph* graph, NodeId id)
+    {
+        auto& p    = *static_cast<Pool*>(pool);
+        auto  task = [graph, id] { graph->execute(id); };
+        // A worker must not block on a full queue: It may be the one that would drain it.
+        if (p.is_current_worker()) return p.try_enqueue(task);
+        try {
+            p.enqueue(task);
+            return true;
+        } catch (const typename Pool::EnqueueBlocked&) {
+            return false;
+        }
+    }
+
+    void post(NodeId id)
+    {
+        if (!post_(pool_, this, id)) {
+            execute(id);
+        }
+    }
+
+    void execute(NodeId id) noexcept
+    {
+        for (;;) {
+            auto& node = nodes_[id];
+            if (!failed_.load(std::memory_order_relaxed)) {
+                try {
+                    node.fn();
+                } catch (...) {
+                    std::scoped_lock lk(mutex_);
+                    if (!error_) error_ = std::current_exception();
+                    failed_.store(true, std::memory_order_relaxed);
+                }
+            }
+
+            // Push ready successors to the pool, but keep one for ourselves.
+            auto next = no_node;
+            for (auto succ : node.successors) {
+                if (nodes_[succ].pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    if (next != no_node) post(next);
+                    next = succ;
+                }
+            }
+            // The graph may be gone after the last node finishes, don't touch `this` anymore.
+            finish_node();
+            if (next == no_node) return;
+            id = next;
+        }
+    }
+
+    void finish_node() noexcept
+    {
+        if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            // Notify under the lock, since a waiter may destroy us as soon as it sees !running_.
+            std::scoped_lock lk(mutex_);
+            running_ = false;
+            cond_.notify_all();
+        }
+    }
+};
+
+template<typename Pool>
+inline void TaskGraph::run(Pool& pool)
+{
+    static_assert(std::is_void_v<typename Pool::ReturnType>, "TaskGraph requires a ThreadPool<void>");
+    {
+        std::scoped_lock lk(mutex_);
+        assert(!running_);
+        if (nodes_.empty()) return;
+        running_ = true;
+        error_   = nullptr;
+    }
+    pool_ = &pool;
+    post_ = &post_impl<Pool>;
+    failed_.store(false, std::memory_order_relaxed);
+    remaining_.store(nodes_.size(), std::memory_order_relaxed);
+    for (auto& node : nodes_) {
+        node.pending.store(node.nb_predecessors, std::memory_order_relaxed);
+    }
+
+    // Once the last root is posted, the whole graph may finish (and be destroyed) before post() returns.
+    auto nb_roots = static_cast<std::size_t>(std::count_if(nodes_.begin(), nodes_.end(), [](const Node& n) { return n.nb_predecessors == 0; }));
+    assert(nb_roots > 0); // Otherwise there's a cycle
+    for (NodeId id = 0; nb_roots > 0; ++id) {
+        if (nodes_[id].nb_predecessors == 0) {
+            --nb_roots;
+            post(id);
+        }
+    }
+}
+
+inline void TaskGraph::wait()
+{
+    std::unique_lock lk(mutex_);
+    cond_.wait(lk, [&] { return !running_; });
+    if (error_) {
+        auto e = std::exchange(error_, nullptr);
+        std::rethrow_exception(e);
+    }
+}
+
+} // namespace clst
+
+#endif // CLST_TASK_GRAPH_HPP
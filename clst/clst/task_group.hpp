@@ -0,0 +1,138 @@
+#ifndef CLST_TASK_GROUP_HPP
+#define CLST_TASK_GROUP_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+
+namespace clst {
+
+/**
+ * A set of tasks submitted to a shared clst::ThreadPool<void>, which can be waited for (and cancelled) on its own.
+ *
+ * - wait() returns as soon as the tasks of this group are done, regardless of other work on the pool.
+ *   Called from a worker of the pool, it runs queued tasks while waiting instead of blocking the worker.
+ * - The first exception thrown by a task cancels the group, and is rethrown by wait().
+ * - cancel() makes queued tasks of the group skip their body. Running tasks are not interrupted.
+ *
+ * After wait() returns (or throws), the group can be reused.
+ */
+template<typename Pool>
+class TaskGroup {
+    static_assert(std::is_void_v<typename Pool::ReturnType>, "TaskGroup requires a ThreadPool<void>");
+
+public:
+    explicit TaskGroup(Pool& pool) noexcept : pool_(pool) {}
+
+    // Waits for the remaining tasks, which refer to us. Exceptions are dropped.
+    ~TaskGroup() noexcept
+    {
+        std::unique_lock lk(mutex_);
+        cond_.wait(lk, [&] { return done_; });
+    }
+
+    // Not copiable or movable.
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    /**
+     * Submit a task to the pool, as part of this group.
+     * Throws Pool::EnqueueBlocked if the pool has been stopped.
+     */
+    template<typename F>
+    void run(F&& f)
+    {
+        if (pending_.fetch_add(1) == 0) {
+            std::scoped_lock lk(mutex_);
+            done_ = false;
+        }
+        try {
+            pool_.enqueue([this, f = std::forward<F>(f)]() mutable { execute(f); });
+        } catch (...) {
+            finish();
+            throw;
+        }
+    }
+
+    /**
+     * Wait for all tasks of the group. Rethrows the first exception thrown by a task.
+     */
+    void wait()
+    {
+        if (pool_.is_current_worker()) {
+            while (pending_.load() != 0) {
+                if (!pool_.run_pending_task()) {
+                    std::unique_lock lk(mutex_);
+                    cond_.wait_for(lk, std::chrono::microseconds(100), [&] { return done_; });
+                }
+            }
+        }
+        std::unique_lock lk(mutex_);
+        cond_.wait(lk, [&] { return done_; });
+        canceled_.store(false, std::memory_order_relaxed);
+        if (error_) {
+            std::rethrow_exception(std::exchange(error_, nullptr));
+        }
+    }
+
+    void cancel() noexcept
+    {
+        canceled_.store(true, std::memory_order_relaxed);
+    }
+
+    bool is_canceled() const noexcept
+    {
+        return canceled_.load(std::memory_order_relaxed);
+    }
+
+private:
+    Pool& pool_;
+
+    std::atomic<std::size_t> pending_{0};
+    std::atomic<bool>        canceled_{false};
+
+    std::mutex              mutex_;
+    std::condition_variable cond_;
+    bool                    done_ = true; // pending_ reached 0. Guarded by mutex_, so that waiters can't outrun finish().
+    std::exception_ptr      error_;
+
+    template<typename F>
+    void execute(F& f) noexcept
+    {
+        if (!canceled_.load(std::memory_order_relaxed)) {
+            try {
+                f();
+            } catch (...) {
+                {
+                    std::scoped_lock lk(mutex_);
+                    if (!error_) error_ = std::current_exception();
+                }
+                cancel();
+            }
+        }
+        finish();
+    }
+
+    void finish() noexcept
+    {
+        if (pending_.fetch_sub(1) == 1) {
+            std::scoped_lock lk(mutex_);
+            if (pending_.load() == 0) { // Unless run() was called again meanwhile
+                done_ = true;
+                cond_.notify_all();
+            }
+        }
+    }
+};
+
+template<typename Pool>
+TaskGroup(Pool&) -> TaskGroup<Pool>;
+
+} // namespace clst
+
+#endif // CLST_TASK_GROUP_HPP
@@ -3,77 +3,948 @@
 
 #include <future>
 #include <vector>
-#include <deque>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <array>
+#include <tuple>
+#include <optional>
+#include <chrono>
+#include <functional>
+#include <cassert>
+#include <system_error>
+#include "clst/builtins.h"
 #include "clst/error.hpp"
+#include "clst/move_only_function.hpp"
+#include "clst/stop_token.hpp"
+#include "clst/wait_policy.hpp"
+#include "clst/thread_pool_stats.hpp"
+#include "clst/sys_utils.hpp"
+#include "clst/arena.hpp"
+#include "clst/ring_buffer.hpp"
+#include "clst/detail/cache_line.hpp"
+#include "clst/detail/chase_lev_deque.hpp"
+#include "clst/detail/mpmc_ring.hpp"
+
+namespace clst {
 
 /**
- * TODO:
+ * Scheduler policies for ThreadPool.
  *
- * - Currently, std::packaged_task is used for type-erased task storage, and per-task future management.
- *   It has quite some overhead if futures aren't required.
- *   Ideally, we want to use std::move_only_function here.
- *   Also, provide a template parameter to select between task storage at compile time.
+ * GlobalQueue:  All workers share a single FIFO queue, protected by a mutex.
+ *               A non-zero `max_jobs` limits the queue size at runtime.
+ * WorkStealing: Each worker owns a Chase-Lev deque. Tasks submitted from inside a worker go to its own deque,
+ *               tasks submitted from outside go to a shared injection queue. Idle workers steal from the others.
+ * BoundedQueue: All workers share a fixed-capacity lock-free MPMC ring of `max_jobs` slots.
+ *               With `max_jobs` = 0, the ring gets 64 slots per worker.
+ *               Producers only block when the ring is full, workers only park when it's empty.
+ * PriorityQueue<Levels, MaxSkips>:
+ *               As GlobalQueue, with one FIFO lane per priority level. Use enqueue/submit(Priority{level}, f),
+ *               level 0 being the highest. Tasks enqueued without a priority go to level Levels / 2.
+ *               Workers take from the highest non-empty lane, but a waiting lane that has been passed over
+ *               MaxSkips times in a row is served next (aging), so low priorities cannot starve.
+ *               With MaxSkips = no_aging, priorities are strict.
+ */
+struct GlobalQueue {};
+struct WorkStealing {};
+struct BoundedQueue {};
+inline constexpr std::size_t no_aging = static_cast<std::size_t>(-1);
+template<std::size_t Levels = 3, std::size_t MaxSkips = 16>
+struct PriorityQueue {
+    static_assert(Levels > 0);
+};
+
+// Priority level of a task, 0 being the highest. For PriorityQueue pools.
+struct Priority {
+    std::size_t level;
+};
+
+/**
+ * Task storage policies for ThreadPool.
  *
- * - Use a template parameter to specialize unbounded / bounded task queue.
- *   A ring buffer should be used for the bounded case.
- *   Currently we always use a dequeue, with optional runtime limit on its size.
+ * PackagedTask:      Every task is a std::packaged_task, which allocates a shared state even if the future is never read.
+ * InplaceTask<Size>: Tasks are stored in a MoveOnlyFunction with `Size` bytes of inline storage.
+ *                    enqueue() does not allocate for small callables, on any scheduler: Queues keep their storage,
+ *                    and only allocate while growing past their high-water mark. submit() pays for a std::promise only.
+ *                    Exception: On a WorkStealing pool, tasks that workers enqueue are boxed on the heap. Workers
+ *                    recycle the boxes, so this only allocates while a worker pushes more tasks than it has taken.
+ *                    Exceptions escaping from enqueue()'d tasks are swallowed, as with PackagedTask.
  */
+struct PackagedTask {};
+template<std::size_t Size = 56>
+struct InplaceTask {};
 
-namespace clst {
+/**
+ * Options for an elastic ThreadPool, which keeps between `min_threads` and `max_threads` workers.
+ *
+ * On enqueue, if no worker is idle, a new one is spawned when either more than `backlog_threshold` tasks are waiting,
+ * or no task has been dequeued for `wait_threshold` while some are waiting.
+ * Workers beyond `min_threads` retire after staying idle for `idle_timeout`.
+ * With min_threads == max_threads, the pool is fixed, as with ThreadPool(nb_threads, max_jobs).
+ */
+struct ThreadPoolOptions {
+    /**
+     * Where to pin workers. Pinning is only supported on Linux, and silently skipped elsewhere or on failure.
+     *
+     * None:     Let the OS schedule workers.
+     * Compact:  Fill logical CPUs core by core (SMT siblings first), so that workers share caches.
+     * Scatter:  One worker per physical core, spread across packages, before doubling up on SMT siblings.
+     * Explicit: Worker slot i goes to cpus[i % cpus.size()].
+     */
+    struct Placement {
+        enum Kind { None, Compact, Scatter, Explicit };
+
+        Kind                  kind = None;
+        std::vector<unsigned> cpus; // Explicit only
+    };
+
+    std::size_t               min_threads       = 1;
+    std::size_t               max_threads       = std::max(1u, std::thread::hardware_concurrency());
+    std::size_t               max_jobs          = 0; // See the scheduler policies
+    std::size_t               backlog_threshold = 0;
+    std::chrono::microseconds wait_threshold{1000};
+    std::chrono::milliseconds idle_timeout{10000};
+    Placement                 placement;
+    std::size_t               scratch_size = 0; // Bytes of per-worker scratch memory, see ThreadPool::current_scratch()
+};
+
+namespace detail {
+
+// Identifies the pool (and the worker slot) the current thread belongs to.
+struct WorkerContext {
+    const void* pool    = nullptr;
+    std::size_t index   = 0;
+    int         cpu     = -1; // Pinned CPU
+    Arena*      scratch = nullptr;
+};
+
+inline thread_local WorkerContext this_worker{};
+
+inline constexpr std::size_t no_worker = static_cast<std::size_t>(-1);
+
+// CPU for every worker slot, -1 if not pinned.
+inline std::vector<int>
+placement_cpus(const ThreadPoolOptions::Placement& placement, std::size_t nb_slots)
+{
+    std::vector<int>      ret(nb_slots, -1);
+    std::vector<unsigned> order;
+    if (placement.kind == ThreadPoolOptions::Placement::Explicit) {
+        order = placement.cpus;
+    } else if (placement.kind != ThreadPoolOptions::Placement::None) {
+        std::vector<CpuInfo> cpus;
+        try {
+            cpus = get_cpu_topology();
+        } catch (const Error&) {
+            return ret;
+        }
+        std::sort(cpus.begin(), cpus.end(), [](const CpuInfo& a, const CpuInfo& b) {
+            return std::tie(a.package, a.core, a.id) < std::tie(b.package, b.core, b.id);
+        });
+        if (placement.kind == ThreadPoolOptions::Placement::Scatter) {
+            // Rank every CPU among its SMT siblings, and its core within the package.
+            struct Key {
+                unsigned rank, core_index, package, id;
+            };
+            std::vector<Key> keys;
+            for (std::size_t i = 0; i < cpus.size(); ++i) {
+                Key key{0, 0, cpus[i].package, cpus[i].id};
+                if (i > 0 && cpus[i].package == cpus[i - 1].package) {
+                    const auto& prev = keys.back();
+                    key.rank         = cpus[i].core == cpus[i - 1].core ? prev.rank + 1 : 0;
+                    key.core_index   = cpus[i].core == cpus[i - 1].core ? prev.core_index : prev.core_index + 1;
+                }
+                keys.push_back(key);
+            }
+            std::sort(keys.begin(), keys.end(), [](const Key& a, const Key& b) {
+                return std::tie(a.rank, a.core_index, a.package) < std::tie(b.rank, b.core_index, b.package);
+            });
+            for (const auto& key : keys) order.push_back(key.id);
+        } else {
+            for (const auto& cpu : cpus) order.push_back(cpu.id);
+        }
+    }
+    if (!order.empty()) {
+        for (std::size_t i = 0; i < nb_slots; ++i) {
+            ret[i] = static_cast<int>(order[i % order.size()]);
+        }
+    }
+    return ret;
+}
+
+template<class Storage, typename R>
+struct TaskStorageTraits;
+
+template<typename R>
+struct TaskStorageTraits<PackagedTask, R> {
+    using type = std::packaged_task<R()>;
+};
+
+template<std::size_t Size, typename R>
+struct TaskStorageTraits<InplaceTask<Size>, R> {
+    using type = MoveOnlyFunction<void(), Size>;
+};
+
+template<class Policy, class TaskT>
+class TaskScheduler;
+
+template<class Policy>
+inline constexpr bool is_priority_scheduler = false;
+template<std::size_t Levels, std::size_t MaxSkips>
+inline constexpr bool is_priority_scheduler<PriorityQueue<Levels, MaxSkips>> = true;
+
+/**
+ * FIFO of tasks, in a ring that doubles when full and never shrinks. Unlike a std::deque, which allocates a chunk
+ * every few pushes, it only allocates while growing past its high-water mark.
+ */
+template<class TaskT>
+class TaskQueue {
+public:
+    static constexpr std::size_t initial_capacity = 16;
+
+    TaskQueue() : ring_(initial_capacity) {}
+
+    void emplace_back(TaskT&& task)
+    {
+        if (ring_.size() == ring_.capacity()) grow();
+        ring_.push(std::move(task));
+    }
+
+    TaskT& front() noexcept
+    {
+        return ring_.front();
+    }
+
+    void pop_front() noexcept
+    {
+        ring_.pop();
+    }
+
+    std::size_t size() const noexcept
+    {
+        return ring_.size();
+    }
+
+    bool empty() const noexcept
+    {
+        return ring_.empty();
+    }
+
+    void swap(TaskQueue& other) noexcept
+    {
+        std::swap(ring_, other.ring_);
+    }
+
+private:
+    RingBuffer<TaskT> ring_;
+
+    void grow()
+    {
+        RingBuffer<TaskT> bigger(ring_.capacity() * 2);
+        while (!ring_.empty()) {
+            bigger.push(std::move(ring_.front()));
+            ring_.pop();
+        }
+        ring_ = std::move(bigger);
+    }
+};
+
+template<class TaskT>
+void
+swap(TaskQueue<TaskT>& a, TaskQueue<TaskT>& b) noexcept
+{
+    a.swap(b);
+}
+
+template<class TaskT>
+class TaskScheduler<GlobalQueue, TaskT> {
+public:
+    TaskScheduler(std::size_t /*nb_workers*/, std::size_t max_jobs) : max_jobs_(max_jobs) {}
+
+    // Returns false if the scheduler has been closed.
+    bool push(TaskT&& task, std::size_t /*worker*/)
+    {
+        {
+            std::unique_lock lk(mutex_);
+            if (max_jobs_) {
+                cond_enqueue_.wait(lk, [&] { return tasks_.size() < max_jobs_ || closed_; });
+            }
+            if (closed_) return false;
+            tasks_.emplace_back(std::move(task));
+        }
+        return true;
+    }
+
+    // As push(), but returns false instead of blocking on a full queue.
+    bool try_push(TaskT&& task, std::size_t /*worker*/)
+    {
+        std::scoped_lock lk(mutex_);
+        if (closed_ || (max_jobs_ && tasks_.size() >= max_jobs_)) return false;
+        tasks_.emplace_back(std::move(task));
+        return true;
+    }
+
+    // Push tasks[0, n) under a single lock, as long as there's room. Returns how many were pushed before closing.
+    // Before blocking on a full queue, calls on_block(i) with the number of tasks pushed so far, so that they can be consumed.
+    template<typename OnBlock>
+    std::size_t push_bulk(TaskT* tasks, std::size_t n, std::size_t /*worker*/, OnBlock&& on_block)
+    {
+        std::unique_lock lk(mutex_);
+        std::size_t      i = 0;
+        while (i < n) {
+            if (max_jobs_ && tasks_.size() >= max_jobs_ && !closed_) {
+                lk.unlock();
+                on_block(i);
+                lk.lock();
+                cond_enqueue_.wait(lk, [&] { return tasks_.size() < max_jobs_ || closed_; });
+            }
+            if (closed_) break;
+            const auto room = max_jobs_ ? std::min(n - i, max_jobs_ - tasks_.size()) : n - i;
+            for (const auto end = i + room; i < end; ++i) {
+                tasks_.emplace_back(std::move(tasks[i]));
+            }
+        }
+        return i;
+    }
+
+    bool try_pop(std::size_t /*worker*/, TaskT& task)
+    {
+        {
+            std::scoped_lock lk(mutex_);
+            if (tasks_.empty()) return false;
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+        if (max_jobs_) {
+            cond_enqueue_.notify_one();
+        }
+        return true;
+    }
+
+    // Reject further pushes, and wake up blocked producers.
+    void close()
+    {
+        {
+            std::scoped_lock lk(mutex_);
+            closed_ = true;
+        }
+        if (max_jobs_) cond_enqueue_.notify_all();
+    }
+
+    // Discard queued tasks. Returns the number of discarded tasks.
+    std::size_t clear()
+    {
+        TaskQueue<TaskT> dropped; // Destroyed outside the lock, since tasks may enqueue from their destructor
+        {
+            std::scoped_lock lk(mutex_);
+            dropped.swap(tasks_);
+        }
+        if (max_jobs_) cond_enqueue_.notify_all();
+        return dropped.size();
+    }
+
+private:
+    std::mutex              mutex_;
+    std::condition_variable cond_enqueue_;
+    TaskQueue<TaskT>        tasks_;
+    std::size_t             max_jobs_;
+    bool                    closed_ = false;
+};
+
+template<std::size_t Levels, std::size_t MaxSkips, class TaskT>
+class TaskScheduler<PriorityQueue<Levels, MaxSkips>, TaskT> {
+public:
+    static constexpr std::size_t default_level = Levels / 2;
+
+    TaskScheduler(std::size_t /*nb_workers*/, std::size_t max_jobs) : max_jobs_(max_jobs) {}
+
+    bool push(TaskT&& task, std::size_t worker)
+    {
+        return push(std::move(task), worker, Priority{default_level});
+    }
+
+    bool push(TaskT&& task, std::size_t /*worker*/, Priority prio)
+    {
+        assert(prio.level < Levels);
+        {
+            std::unique_lock lk(mutex_);
+            if (max_jobs_) {
+                cond_enqueue_.wait(lk, [&] { return size_ < max_jobs_ || closed_; });
+            }
+            if (closed_) return false;
+            lanes_[prio.level].emplace_back(std::move(task));
+            ++size_;
+        }
+        return true;
+    }
+
+    bool try_push(TaskT&& task, std::size_t /*worker*/)
+    {
+        std::scoped_lock lk(mutex_);
+        if (closed_ || (max_jobs_ && size_ >= max_jobs_)) return false;
+        lanes_[default_level].emplace_back(std::move(task));
+        ++size_;
+        return true;
+    }
+
+    template<typename OnBlock>
+    std::size_t push_bulk(TaskT* tasks, std::size_t n, std::size_t /*worker*/, OnBlock&& on_block)
+    {
+        auto&            lane = lanes_[default_level];
+        std::unique_lock lk(mutex_);
+        std::size_t      i = 0;
+        while (i < n) {
+            if (max_jobs_ && size_ >= max_jobs_ && !closed_) {
+                lk.unlock();
+                on_block(i);
+                lk.lock();
+                cond_enqueue_.wait(lk, [&] { return size_ < max_jobs_ || closed_; });
+            }
+            if (closed_) break;
+            const auto room = max_jobs_ ? std::min(n - i, max_jobs_ - size_) : n - i;
+            for (const auto end = i + room; i < end; ++i) {
+                lane.emplace_back(std::move(tasks[i]));
+            }
+            size_ += room;
+        }
+        return i;
+    }
+
+    bool try_pop(std::size_t /*worker*/, TaskT& task)
+    {
+        {
+            std::scoped_lock lk(mutex_);
+            if (size_ == 0) return false;
+            auto level = Levels;
+            if constexpr (MaxSkips != no_aging) {
+                for (std::size_t l = 1; l < Levels; ++l) {
+                    if (skips_[l] >= MaxSkips && !lanes_[l].empty()) {
+                        level = l;
+                        break;
+                    }
+                }
+            }
+            if (level == Levels) {
+                level = 0;
+                while (lanes_[level].empty()) ++level;
+            }
+            if constexpr (MaxSkips != no_aging) {
+                skips_[level] = 0;
+                for (auto l = level + 1; l < Levels; ++l) {
+                    if (!lanes_[l].empty()) ++skips_[l];
+                }
+            }
+            task = std::move(lanes_[level].front());
+            lanes_[level].pop_front();
+            --size_;
+        }
+        if (max_jobs_) {
+            cond_enqueue_.notify_one();
+        }
+        return true;
+    }
+
+    void close()
+    {
+        {
+            std::scoped_lock lk(mutex_);
+            closed_ = true;
+        }
+        if (max_jobs_) cond_enqueue_.notify_all();
+    }
+
+    std::size_t clear()
+    {
+        std::array<TaskQueue<TaskT>, Levels> dropped; // Destroyed outside the lock, as in GlobalQueue
+        std::size_t                          n;
+        {
+            std::scoped_lock lk(mutex_);
+            n = size_;
+            dropped.swap(lanes_);
+            size_ = 0;
+            skips_.fill(0);
+        }
+        if (max_jobs_) cond_enqueue_.notify_all();
+        return n;
+    }
+
+private:
+    std::mutex                           mutex_;
+    std::condition_variable              cond_enqueue_;
+    std::array<TaskQueue<TaskT>, Levels> lanes_;
+    std::array<std::size_t, Levels>      skips_{}; // Consecutive times each waiting lane was passed over
+    std::size_t                          size_ = 0;
+    std::size_t                          max_jobs_;
+    bool                                 closed_ = false;
+};
+
+template<class TaskT>
+class TaskScheduler<WorkStealing, TaskT> {
+public:
+    // Spare boxes kept by each worker.
+    static constexpr std::size_t max_spare_boxes = 256;
+
+    TaskScheduler(std::size_t nb_workers, std::size_t max_jobs)
+    : injector_(nb_workers, max_jobs), locals_(std::make_unique<Local[]>(nb_workers)), nb_workers_(nb_workers)
+    {
+        for (std::size_t i = 0; i < nb_workers_; ++i) {
+            locals_[i].spare.reserve(max_spare_boxes);
+        }
+    }
+
+    ~TaskScheduler()
+    {
+        TaskT* p;
+        for (std::size_t i = 0; i < nb_workers_; ++i) {
+            while (locals_[i].deque.pop(p)) delete p;
+            for (auto* box : locals_[i].spare) delete box;
+        }
+    }
+
+    bool push(TaskT&& task, std::size_t worker)
+    {
+        if (worker == no_worker) {
+            return injector_.push(std::move(task), worker);
+        }
+        locals_[worker].deque.push(box(worker, std::move(task)));
+        return true;
+    }
+
+    // Worker deques are never full.
+    bool try_push(TaskT&& task, std::size_t worker)
+    {
+        if (worker == no_worker) {
+            return injector_.try_push(std::move(task), worker);
+        }
+        return push(std::move(task), worker);
+    }
+
+    template<typename OnBlock>
+    std::size_t push_bulk(TaskT* tasks, std::size_t n, std::size_t worker, OnBlock&& on_block)
+    {
+        if (worker == no_worker) {
+            return injector_.push_bulk(tasks, n, worker, on_block);
+        }
+        for (std::size_t i = 0; i < n; ++i) {
+            locals_[worker].deque.push(box(worker, std::move(tasks[i])));
+        }
+        return n;
+    }
+
+    bool try_pop(std::size_t worker, TaskT& task)
+    {
+        bool stolen;
+        return try_pop(worker, task, stolen);
+    }
+
+    // Also tells whether the task was stolen from another worker.
+    bool try_pop(std::size_t worker, TaskT& task, bool& stolen)
+    {
+        stolen = false;
+        TaskT* p;
+        if (worker != no_worker && locals_[worker].deque.pop(p)) {
+            return unbox(p, task, worker);
+        }
+        if (injector_.try_pop(worker, task)) {
+            return true;
+        }
+        // Start from a different victim each time, so thieves don't pile onto the same deque.
+        const auto start = worker == no_worker ? steal_start_.fetch_add(1, std::memory_order_relaxed) : worker + 1;
+        for (std::size_t i = 0; i < nb_workers_; ++i) {
+            const auto victim = (start + i) % nb_workers_;
+            if (victim == worker) continue;
+            for (;;) {
+                const auto res = locals_[victim].deque.steal(p);
+                if (res == StealResult::Success) {
+                    stolen = true;
+                    return unbox(p, task, worker);
+                }
+                if (res == StealResult::Empty) break;
+            }
+        }
+        return false;
+    }
+
+    void close()
+    {
+        injector_.close();
+    }
+
+    std::size_t clear()
+    {
+        auto   n = injector_.clear();
+        TaskT* p;
+        for (std::size_t i = 0; i < nb_workers_; ++i) {
+            for (;;) {
+                const auto res = locals_[i].deque.steal(p);
+                if (res == StealResult::Empty) break;
+                if (res == StealResult::Success) {
+                    delete p;
+                    ++n;
+                }
+            }
+        }
+        return n;
+    }
+
+private:
+    using Deque       = ChaseLevDeque<TaskT*>;
+    using StealResult = typename Deque::StealResult;
 
-template<typename R = void>
+    /**
+     * Chase-Lev slots must be trivially copyable, so tasks pushed by workers are boxed.
+     * Each worker recycles the boxes it takes tasks out of, its own or stolen ones, and boxes the tasks it pushes
+     * into those: A worker that keeps enqueuing doesn't allocate once it has taken as many tasks as it pushes.
+     * `spare` is only ever touched by the owning worker.
+     */
+    struct alignas(cache_line_size) Local {
+        Deque               deque;
+        std::vector<TaskT*> spare;
+    };
+
+    TaskScheduler<GlobalQueue, TaskT> injector_;
+    std::unique_ptr<Local[]>          locals_;
+    std::size_t                       nb_workers_;
+    std::atomic<std::size_t>          steal_start_{0};
+
+    TaskT* box(std::size_t worker, TaskT&& task)
+    {
+        auto& spare = locals_[worker].spare;
+        if (spare.empty()) return new TaskT(std::move(task));
+        auto* const p = spare.back();
+        spare.pop_back();
+        *p = std::move(task);
+        return p;
+    }
+
+    // `worker` is the calling worker, which keeps the box.
+    bool unbox(TaskT* p, TaskT& task, std::size_t worker)
+    {
+        task = std::move(*p);
+        if (worker != no_worker && locals_[worker].spare.size() < max_spare_boxes) {
+            *p = TaskT{}; // Let go of whatever the moved-from task still holds
+            locals_[worker].spare.push_back(p);
+        } else {
+            delete p;
+        }
+        return true;
+    }
+};
+
+template<class TaskT>
+class TaskScheduler<BoundedQueue, TaskT> {
+public:
+    static constexpr std::size_t default_jobs_per_worker = 64;
+
+    TaskScheduler(std::size_t nb_workers, std::size_t max_jobs)
+    : ring_(max_jobs != 0 ? max_jobs : std::max<std::size_t>(nb_workers, 1) * default_jobs_per_worker)
+    {}
+
+    bool push(TaskT&& task, std::size_t /*worker*/)
+    {
+        if (ring_.try_emplace(std::move(task))) return true;
+
+        // Full. Only now do we touch the mutex.
+        std::unique_lock lk(mutex_);
+        for (;;) {
+            if (closed_) return false;
+            nb_blocked_.fetch_add(1);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (ring_.try_emplace(std::move(task))) {
+                nb_blocked_.fetch_sub(1);
+                return true;
+            }
+            cond_enqueue_.wait(lk);
+            nb_blocked_.fetch_sub(1);
+        }
+    }
+
+    bool try_push(TaskT&& task, std::size_t /*worker*/)
+    {
+        return ring_.try_emplace(std::move(task));
+    }
+
+    // The ring takes no lock anyway.
+    template<typename OnBlock>
+    std::size_t push_bulk(TaskT* tasks, std::size_t n, std::size_t worker, OnBlock&& on_block)
+    {
+        std::size_t i = 0;
+        for (; i < n; ++i) {
+            if (ring_.try_emplace(std::move(tasks[i]))) continue;
+            on_block(i);
+            if (!push(std::move(tasks[i]), worker)) break;
+        }
+        return i;
+    }
+
+    bool try_pop(std::size_t /*worker*/, TaskT& task)
+    {
+        if (!ring_.try_pop(task)) return false;
+        // Pairs with nb_blocked_.fetch_add(): Either the producer sees the free slot, or we see the producer.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (nb_blocked_.load(std::memory_order_relaxed) != 0) {
+            {
+                std::scoped_lock lk(mutex_);
+            }
+            cond_enqueue_.notify_one();
+        }
+        return true;
+    }
+
+    void close()
+    {
+        {
+            std::scoped_lock lk(mutex_);
+            closed_ = true;
+        }
+        cond_enqueue_.notify_all();
+    }
+
+    std::size_t clear()
+    {
+        std::size_t n = 0;
+        TaskT       task;
+        while (ring_.try_pop(task)) {
+            task = TaskT{};
+            ++n;
+        }
+        {
+            std::scoped_lock lk(mutex_);
+        }
+        cond_enqueue_.notify_all();
+        return n;
+    }
+
+private:
+    MpmcRing<TaskT>          ring_;
+    std::atomic<std::size_t> nb_blocked_{0};
+    std::mutex               mutex_;
+    std::condition_variable  cond_enqueue_;
+    bool                     closed_ = false;
+};
+
+#if CLST_CPP20
+// Defined in clst/coro.hpp
+template<class Pool>
+class ScheduleAwaiter;
+#endif
+
+} // namespace detail
+
+/**
+ * Pool of worker threads running tasks that return R. See above for the Scheduler and Storage policies.
+ *
+ * The WaitPolicy (see clst/wait_policy.hpp) decides how idle workers wait for tasks.
+ * BlockingWait parks them right away. SpinWait keeps them spinning for a while, which cuts the wake-up latency
+ * of bursty submissions at the cost of CPU time.
+ *
+ * With Stats = true, the pool keeps per-worker counters and latency histograms, readable through stats().
+ * Tasks are then timestamped on enqueue, and every run is timed. With Stats = false, none of this is compiled in.
+ */
+template<typename R = void, class Scheduler = GlobalQueue, class Storage = PackagedTask, class WaitPolicy = BlockingWait, bool Stats = false>
 class ThreadPool {
 public:
-    using ReturnType = R;
+    using ReturnType     = R;
+    using SchedulerType  = Scheduler;
+    using StorageType    = Storage;
+    using WaitPolicyType = WaitPolicy;
+
+    static constexpr bool has_stats = Stats;
 
     ThreadPool(std::size_t nb_threads, std::size_t max_jobs = 0) noexcept;
 
     /**
-     * Initialize workers with a custom callable.
+     * Initialize workers with a custom callable.
+     */
+    template<typename F>
+    ThreadPool(const F& init_fn, std::size_t nb_threads, std::size_t max_jobs) noexcept;
+
+    /**
+     * Elastic pool, starting with `opts.min_threads` workers.
+     */
+    explicit ThreadPool(const ThreadPoolOptions& opts) noexcept;
+
+    /**
+     * Elastic pool. `init_fn` runs at the start of every new worker, including those spawned later on.
+     */
+    template<typename F>
+    ThreadPool(const F& init_fn, const ThreadPoolOptions& opts) noexcept;
+
+    ~ThreadPool() noexcept;
+
+    // Not copiable.
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Not movable.
+    // If you really need to move me, wrap me inside unique_ptr.
+
+    /**
+     * Request to stop the pool.
+     *
+     * Remaining tasks will continue on. Enqueuing is blocked.
+     */
+    void stop() noexcept;
+
+    /**
+     * Request to stop the pool immediately. Discards tasks in the queue.
+     */
+    void stop_now() noexcept;
+
+    /**
+     * Wait for all tasks to finish.
+     */
+    void wait_all() noexcept;
+
+    /**
+     * As wait_all(), but give up once `token` is signalled.
+     * Returns false if tasks were still in flight then.
+     */
+    bool wait_all(const StopToken& token) noexcept;
+
+    /**
+     * Wait for a future to become ready, running queued tasks on the calling thread meanwhile.
+     *
+     * Use this instead of fut.wait() inside pool tasks, so that fork-join style recursion
+     * does not starve the pool of workers.
+     */
+    template<typename Future>
+    void wait(const Future& fut);
+
+    /**
+     * As wait(fut), but give up once `token` is signalled.
+     * Returns false if the future wasn't ready then.
+     */
+    template<typename Future>
+    bool wait(const Future& fut, const StopToken& token);
+
+    /**
+     * Run one queued task on the calling thread.
+     * Returns false if there was none.
+     */
+    bool run_pending_task();
+
+    /**
+     * Enqueue task and receive a future.
+     */
+    template<typename F>
+    [[nodiscard]] auto submit(F&& f);
+
+    /**
+     * Enqueue task without getting a future.
+     */
+    template<typename F>
+    void enqueue(F&& f);
+
+    /**
+     * As enqueue(), but never blocks: Returns false if the queue is full (see ThreadPoolOptions::max_jobs),
+     * or the pool is stopped. `f` is consumed either way.
      */
     template<typename F>
-    ThreadPool(const F& init_fn, std::size_t nb_threads, std::size_t max_jobs) noexcept;
+    bool try_enqueue(F&& f);
 
-    ~ThreadPool() noexcept;
+    /**
+     * As submit() and enqueue(), at the given priority level. Requires the PriorityQueue scheduler.
+     */
+    template<typename F>
+    [[nodiscard]] auto submit(Priority prio, F&& f);
+    template<typename F>
+    void enqueue(Priority prio, F&& f);
 
-    // Not copiable.
-    ThreadPool(const ThreadPool&) = delete;
-    ThreadPool& operator=(const ThreadPool&) = delete;
+    /**
+     * As submit() and enqueue(), but the task runs on the given worker, which takes it before any shared task.
+     * The worker index must be below ThreadPoolOptions::min_threads, i.e. below size() for a fixed pool:
+     * Only those workers are permanent in an elastic pool.
+     */
+    template<typename F>
+    [[nodiscard]] auto submit_to(std::size_t worker, F&& f);
+    template<typename F>
+    void enqueue_to(std::size_t worker, F&& f);
 
-    // Not movable.
-    // If you really need to move me, wrap me inside unique_ptr.
+    /**
+     * As submit_to(), picking the worker by hashing `key` with std::hash. Tasks with equal keys run on the same worker,
+     * one at a time, in submission order.
+     */
+    template<typename Key, typename F>
+    [[nodiscard]] auto submit_keyed(const Key& key, F&& f);
+    template<typename Key, typename F>
+    void enqueue_keyed(const Key& key, F&& f);
 
     /**
-     * Request to stop the pool.
+     * Enqueue every callable in [first, last), taking the queue lock once and waking up as many workers as needed.
      *
-     * Remaining tasks will continue on. Enqueuing is blocked.
+     * Callables are copied from the range (pass move iterators to move them).
+     * If the pool is stopped midway, the tasks already queued still run, and EnqueueBlocked is thrown.
      */
-    void stop() noexcept;
+    template<typename It>
+    void enqueue_bulk(It first, It last);
 
     /**
-     * Request to stop the pool immediately. Discards tasks in the queue.
+     * As enqueue_bulk(), and receive one future per task.
      */
-    void stop_now() noexcept;
+    template<typename It>
+    [[nodiscard]] auto submit_bulk(It first, It last);
+
+    // Current number of workers.
+    std::size_t size() const noexcept
+    {
+        return nb_live_.load(std::memory_order_relaxed);
+    }
 
     /**
-     * Wait for all tasks to finish.
+     * Snapshot of the statistics. Requires Stats = true.
      */
-    void wait_all() noexcept;
+    ThreadPoolStats stats() const;
 
     /**
-     * Enqueue task and receive a future.
+     * Whether the calling thread is one of our workers.
      */
-    template<typename F>
-    [[nodiscard]] auto submit(F&& f);
+    bool is_current_worker() const noexcept
+    {
+        return current_worker() != detail::no_worker;
+    }
 
     /**
-     * Enqueue task without getting a future.
+     * CPU the calling worker is pinned to (see ThreadPoolOptions::Placement).
+     * -1 if it isn't pinned, or if the calling thread isn't a pool worker.
      */
-    template<typename F>
-    void enqueue(F&& f);
+    static int current_worker_cpu() noexcept
+    {
+        return detail::this_worker.cpu;
+    }
+
+    static constexpr std::size_t no_worker = detail::no_worker;
+
+    /**
+     * Index of the calling worker in its pool, in [0, max number of workers).
+     * no_worker if the calling thread isn't a pool worker.
+     */
+    static std::size_t current_worker_index() noexcept
+    {
+        return detail::this_worker.pool ? detail::this_worker.index : no_worker;
+    }
+
+    /**
+     * Scratch arena of the calling worker, with ThreadPoolOptions::scratch_size bytes.
+     * Everything a task allocates from it is freed when the task returns. No allocation ever hits the heap.
+     * nullptr if there's no scratch memory, or if the calling thread isn't a pool worker.
+     */
+    static Arena* current_scratch() noexcept
+    {
+        return detail::this_worker.scratch;
+    }
+
+#if CLST_CPP20
+    /**
+     * `co_await pool.schedule()` resumes the calling coroutine on a worker. Requires clst/coro.hpp.
+     */
+    auto schedule() noexcept
+    {
+        return detail::ScheduleAwaiter<ThreadPool>(*this);
+    }
+#endif
 
     /* Exception throwed when enqueuing on a stopping or stopped pool */
     class EnqueueBlocked : public Error {
@@ -86,146 +957,699 @@ public:
 
 
 private:
-    std::vector<std::thread> workers;
+    using TaskT = typename detail::TaskStorageTraits<Storage, R>::type;
+    using Entry = std::conditional_t<Stats, detail::StampedTask<TaskT>, TaskT>; // What the scheduler holds
+    using Clock = std::chrono::steady_clock;
+    static constexpr bool is_packaged = std::is_same_v<Storage, PackagedTask>;
+
+    struct alignas(detail::cache_line_size) Worker {
+        std::thread                thread;
+        detail::Parker<WaitPolicy> parker;
+        std::atomic<bool>          idle{false};   // Whether this worker is in idle_list_
+        std::atomic<bool>          active{false}; // Whether the slot is taken by a live worker
+
+        // Tasks for this worker only, see submit_to().
+        detail::TaskScheduler<GlobalQueue, Entry> inbox{1, 0};
+        std::atomic<std::size_t>                  inbox_size{0};
+    };
+
+    ThreadPoolOptions                          opts_;
+    bool                                       elastic_;
+    std::size_t                                nb_slots_; // Max number of workers
+    std::function<void()>                      init_fn_;
+    std::vector<int>                           slot_cpus_;
+    detail::TaskScheduler<Scheduler, Entry>    scheduler_;
+    std::unique_ptr<Worker[]>                  workers_;
+    std::unique_ptr<detail::WorkerStats[]>     stats_; // One per worker, plus one for outside threads. Only with Stats.
 
-    std::mutex mutex_;
-    std::condition_variable cond;
-    bool stop_ = false;
+    std::atomic<bool> stop_{false};
+    std::atomic<bool> discard_{false};
 
-    std::size_t nb_working = 0;
-    std::condition_variable working_cond;
+    // Tasks that are queued or running.
+    alignas(detail::cache_line_size) std::atomic<std::size_t> in_flight_{0};
+    std::mutex              done_mutex_;
+    std::condition_variable done_cond_;
 
-    std::condition_variable cond_enqueue;
-    std::size_t max_jobs;
+    // Workers that are about to park, or parked.
+    alignas(detail::cache_line_size) std::atomic<std::size_t> nb_idle_{0};
+    std::mutex               idle_mutex_;
+    std::vector<std::size_t> idle_list_;
 
-    using TaskT = std::packaged_task<R()>;
-    std::deque<TaskT> tasks;
+    // Elastic mode.
+    alignas(detail::cache_line_size) std::atomic<std::size_t> nb_live_{0};
+    std::atomic<Clock::rep> last_dequeue_{0};
+    std::mutex              grow_mutex_; // Taken when spawning workers
 
-    void enqueue_task(TaskT&& task);
+    template<typename... Prio>
+    void enqueue_task(TaskT&& task, Prio... prio);
+    void enqueue_task_to(std::size_t worker, TaskT&& task);
 
-    void worker_loop()
+    template<typename Key>
+    std::size_t worker_for_key(const Key& key) const noexcept
     {
-        for (;;) {
-            TaskT task;
+        assert(opts_.min_threads > 0);
+        return std::hash<Key>{}(key) % opts_.min_threads;
+    }
+    void enqueue_tasks(Entry* entries, std::size_t n);
+
+    static Entry make_entry(TaskT&& task)
+    {
+        if constexpr (Stats) {
+            return Entry{std::move(task), Clock::now()};
+        } else {
+            return std::move(task);
+        }
+    }
 
+    static TaskT& task_of(Entry& entry) noexcept
+    {
+        if constexpr (Stats) {
+            return entry.task;
+        } else {
+            return entry;
+        }
+    }
+
+    // Where the stats of the calling thread go.
+    std::size_t stats_slot() const noexcept
+    {
+        const auto idx = current_worker();
+        return idx == detail::no_worker ? nb_slots_ : idx;
+    }
+
+    bool pop_entry(std::size_t worker, Entry& entry)
+    {
+        // Targeted tasks first.
+        if (worker != detail::no_worker && workers_[worker].inbox_size.load(std::memory_order_relaxed) != 0) {
+            if (workers_[worker].inbox.try_pop(worker, entry)) {
+                workers_[worker].inbox_size.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        if constexpr (Stats && std::is_same_v<Scheduler, WorkStealing>) {
+            bool stolen;
+            if (!scheduler_.try_pop(worker, entry, stolen)) return false;
+            if (stolen) stats_[stats_slot()].steals.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        } else {
+            return scheduler_.try_pop(worker, entry);
+        }
+    }
+
+    // Wrap f into a task, which fulfills `fut`.
+    template<typename F>
+    TaskT package(F&& f, std::future<R>& fut);
+
+    std::size_t current_worker() const noexcept
+    {
+        return detail::this_worker.pool == this ? detail::this_worker.index : detail::no_worker;
+    }
+
+    void set_idle(std::size_t idx)
+    {
+        std::scoped_lock lk(idle_mutex_);
+        if (!workers_[idx].idle.load(std::memory_order_relaxed)) {
+            workers_[idx].idle.store(true, std::memory_order_relaxed);
+            idle_list_.push_back(idx);
+            nb_idle_.store(idle_list_.size());
+        }
+    }
+
+    void clear_idle(std::size_t idx)
+    {
+        if (!workers_[idx].idle.load(std::memory_order_relaxed)) return; // Fast path: already taken off by a waker
+        std::scoped_lock lk(idle_mutex_);
+        if (workers_[idx].idle.load(std::memory_order_relaxed)) {
+            workers_[idx].idle.store(false, std::memory_order_relaxed);
+            idle_list_.erase(std::find(idle_list_.begin(), idle_list_.end(), idx));
+            nb_idle_.store(idle_list_.size());
+        }
+    }
+
+    void wake_one()
+    {
+        // Pairs with the fence in worker_loop(): Either we see the idle worker, or it sees our task.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (nb_idle_.load(std::memory_order_relaxed) == 0) return;
+        std::size_t idx;
+        {
+            std::scoped_lock lk(idle_mutex_);
+            if (idle_list_.empty()) return;
+            idx = idle_list_.back();
+            idle_list_.pop_back();
+            nb_idle_.store(idle_list_.size());
+            workers_[idx].idle.store(false, std::memory_order_relaxed);
+        }
+        workers_[idx].parker.unpark();
+    }
+
+    // Wake up to n idle workers.
+    void wake_some(std::size_t n)
+    {
+        if (n == 1) return wake_one();
+        std::atomic_thread_fence(std::memory_order_seq_cst); // See wake_one()
+        if (nb_idle_.load(std::memory_order_relaxed) == 0) return;
+        std::scoped_lock lk(idle_mutex_);
+        for (; n > 0 && !idle_list_.empty(); --n) {
+            const auto idx = idle_list_.back();
+            idle_list_.pop_back();
+            workers_[idx].idle.store(false, std::memory_order_relaxed);
+            workers_[idx].parker.unpark();
+        }
+        nb_idle_.store(idle_list_.size());
+    }
+
+    void wake_all()
+    {
+        std::vector<std::size_t> list;
+        {
+            std::scoped_lock lk(idle_mutex_);
+            list.swap(idle_list_);
+            nb_idle_.store(0);
+            for (auto idx : list) {
+                workers_[idx].idle.store(false, std::memory_order_relaxed);
+            }
+        }
+        for (auto idx : list) {
+            workers_[idx].parker.unpark();
+        }
+    }
+
+    void finish_tasks(std::size_t n) noexcept
+    {
+        if (in_flight_.fetch_sub(n) == n) {
             {
-                std::unique_lock lk(mutex_);
-                cond.wait(lk, [&] { return stop_ || !tasks.empty(); });
-                if (tasks.empty())
-                    return;
-                task = std::move(tasks.front());
-                tasks.pop_front();
-                nb_working += 1;
+                std::scoped_lock lk(done_mutex_);
+            }
+            done_cond_.notify_all();
+            if (stop_.load()) {
+                wake_all(); // Let idle workers observe the exit condition
+            }
+        }
+    }
+
+    void run_task(Entry& entry) noexcept
+    {
+        if (!discard_.load(std::memory_order_relaxed)) {
+            [[maybe_unused]] Clock::time_point start;
+            if constexpr (Stats) {
+                start      = Clock::now();
+                auto& slot = stats_[stats_slot()];
+                slot.started.fetch_add(1, std::memory_order_relaxed);
+                slot.queue_wait.record(start - entry.enqueued);
+            }
+            // Tasks may nest through run_pending_task(), so rewind the scratch arena instead of clearing it.
+            auto* const scratch = current_worker() != detail::no_worker ? detail::this_worker.scratch : nullptr;
+            void* const top     = scratch ? scratch->top() : nullptr;
+            auto&       task    = task_of(entry);
+            if constexpr (is_packaged) {
+                task();
+            } else {
+                try {
+                    task();
+                } catch (...) {
+                }
             }
-            if (max_jobs) {
-                cond_enqueue.notify_one();
+            if (scratch) scratch->reset(top);
+            if constexpr (Stats) {
+                auto& slot = stats_[stats_slot()];
+                slot.run_time.record(Clock::now() - start);
+                slot.executed.fetch_add(1, std::memory_order_release);
             }
+        }
+        entry = Entry{};
+        finish_tasks(1);
+    }
 
-            task();
+    ThreadPool(const ThreadPoolOptions& opts, std::function<void()> init_fn) noexcept;
 
-            {
-                std::scoped_lock lk(mutex_);
-                if (--nb_working == 0) {
-                    working_cond.notify_all();
+    static ThreadPoolOptions fixed_options(std::size_t nb_threads, std::size_t max_jobs) noexcept
+    {
+        ThreadPoolOptions opts;
+        opts.min_threads = opts.max_threads = nb_threads;
+        opts.max_jobs                       = max_jobs;
+        return opts;
+    }
+
+    void start_workers()
+    {
+        std::scoped_lock lk(grow_mutex_);
+        for (std::size_t i = 0; i < opts_.min_threads; ++i) {
+            spawn_worker(i);
+        }
+    }
+
+    // Start a worker in a free slot. grow_mutex_ must be held.
+    void spawn_worker(std::size_t idx)
+    {
+        auto& worker = workers_[idx];
+        if (worker.thread.joinable()) {
+            worker.thread.join(); // Retired, and on its way out
+        }
+        worker.active.store(true, std::memory_order_relaxed);
+        nb_live_.fetch_add(1);
+        worker.thread = std::thread([this, idx, cpu = slot_cpus_[idx]]() mutable {
+            if (cpu >= 0) {
+                try {
+                    set_thread_affinity(static_cast<unsigned>(cpu));
+                } catch (const Error&) {
+                    cpu = -1;
                 }
             }
+            // Allocated by the worker itself, so that it's local to its node.
+            std::unique_ptr<unsigned char[]> scratch_buf;
+            std::optional<Arena>             scratch;
+            if (opts_.scratch_size) {
+                scratch_buf = std::make_unique<unsigned char[]>(opts_.scratch_size);
+                scratch.emplace(scratch_buf.get(), static_cast<std::ptrdiff_t>(opts_.scratch_size));
+            }
+            detail::this_worker = {this, idx, cpu, scratch ? &*scratch : nullptr};
+            if (init_fn_) init_fn_();
+            worker_loop(idx);
+        });
+    }
+
+    // Spawn a worker if the backlog calls for it. Must follow a wake-up attempt, for its fence.
+    void maybe_grow()
+    {
+        if (!elastic_ || nb_idle_.load(std::memory_order_relaxed) != 0) return;
+        const auto live = nb_live_.load(std::memory_order_relaxed);
+        if (live >= nb_slots_) return;
+        const auto in_flight = in_flight_.load(std::memory_order_relaxed);
+        const auto backlog   = in_flight > live ? in_flight - live : 0; // No worker is idle, so all of them are busy
+        auto       grow      = live == 0 || backlog > opts_.backlog_threshold;
+        if (!grow && backlog > 0) {
+            const auto since = Clock::duration(Clock::now().time_since_epoch().count() - last_dequeue_.load(std::memory_order_relaxed));
+            grow             = since > opts_.wait_threshold;
+        }
+        if (!grow) return;
+
+        std::scoped_lock lk(grow_mutex_);
+        if (stop_.load() || nb_live_.load() >= nb_slots_) return;
+        for (std::size_t i = 0; i < nb_slots_; ++i) {
+            if (!workers_[i].active.load(std::memory_order_relaxed)) {
+                try {
+                    spawn_worker(i);
+                } catch (const std::system_error&) {
+                    // Out of threads. Carry on with the current workers.
+                    workers_[i].active.store(false, std::memory_order_relaxed);
+                    nb_live_.fetch_sub(1);
+                }
+                return;
+            }
+        }
+    }
+
+    // Give up our slot. The first min_threads slots are permanent, so that they can be targeted by submit_to().
+    bool try_retire(std::size_t idx) noexcept
+    {
+        if (idx < opts_.min_threads) return false;
+        nb_live_.fetch_sub(1);
+        return true;
+    }
+
+    void worker_loop(std::size_t idx)
+    {
+        Entry entry;
+
+        for (;;) {
+            if (pop_entry(idx, entry)) {
+                if (elastic_) {
+                    last_dequeue_.store(Clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+                }
+                run_task(entry);
+                continue;
+            }
+
+            // Announce that we are going to sleep, then look again before actually parking.
+            set_idle(idx);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (pop_entry(idx, entry)) {
+                clear_idle(idx);
+                run_task(entry);
+                continue;
+            }
+            // After stop, nothing can be enqueued anymore, so we're done when nothing is in flight.
+            if (stop_.load() && in_flight_.load() == 0) {
+                clear_idle(idx);
+                return;
+            }
+            if constexpr (Stats) {
+                stats_[idx].parks.fetch_add(1, std::memory_order_relaxed);
+            }
+            if (elastic_ && idx >= opts_.min_threads) {
+                if (!workers_[idx].parker.park_until(Clock::now() + opts_.idle_timeout)) {
+                    clear_idle(idx);
+                    if (try_retire(idx)) {
+                        // Pairs with the fence in wake_one(): Either the producer sees us gone and spawns a worker,
+                        // or we see its task.
+                        if (!pop_entry(idx, entry)) {
+                            workers_[idx].active.store(false, std::memory_order_relaxed);
+                            return;
+                        }
+                        nb_live_.fetch_add(1);
+                        run_task(entry);
+                    }
+                    continue;
+                }
+            } else {
+                workers_[idx].parker.park();
+            }
+            clear_idle(idx); // In case of a stale wake-up
         }
     }
 };
 
-template<typename R>
-inline ThreadPool<R>::ThreadPool(std::size_t N, std::size_t max_jobs_) noexcept : max_jobs(max_jobs_)
+template<typename R, class S, class St, class W, bool Sa>
+inline ThreadPool<R, S, St, W, Sa>::ThreadPool(std::size_t N, std::size_t max_jobs) noexcept
+: ThreadPool(fixed_options(N, max_jobs), nullptr)
+{}
+
+template<typename R, class S, class St, class W, bool Sa>
+template<typename F>
+inline ThreadPool<R, S, St, W, Sa>::ThreadPool(const F& init_fn, std::size_t N, std::size_t max_jobs) noexcept
+: ThreadPool(fixed_options(N, max_jobs), init_fn) // init_fn must be copyable
+{}
+
+template<typename R, class S, class St, class W, bool Sa>
+inline ThreadPool<R, S, St, W, Sa>::ThreadPool(const ThreadPoolOptions& opts) noexcept
+: ThreadPool(opts, nullptr)
+{}
+
+template<typename R, class S, class St, class W, bool Sa>
+template<typename F>
+inline ThreadPool<R, S, St, W, Sa>::ThreadPool(const F& init_fn, const ThreadPoolOptions& opts) noexcept
+: ThreadPool(opts, std::function<void()>(init_fn))
+{}
+
+template<typename R, class S, class St, class W, bool Sa>
+inline ThreadPool<R, S, St, W, Sa>::ThreadPool(const ThreadPoolOptions& opts, std::function<void()> init_fn) noexcept
+: opts_(opts), elastic_(opts.min_threads < opts.max_threads), nb_slots_(opts.max_threads), init_fn_(std::move(init_fn)),
+  slot_cpus_(detail::placement_cpus(opts.placement, opts.max_threads)), scheduler_(opts.max_threads, opts.max_jobs), workers_(std::make_unique<Worker[]>(opts.max_threads))
 {
-    for (std::size_t i = 0; i < N; ++i) {
-        workers.emplace_back( [this] {
-            worker_loop();
-        });
+    assert(opts_.max_threads > 0 && opts_.min_threads <= opts_.max_threads);
+    if constexpr (has_stats) {
+        stats_ = std::make_unique<detail::WorkerStats[]>(nb_slots_ + 1);
     }
+    idle_list_.reserve(nb_slots_);
+    last_dequeue_.store(Clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+    start_workers();
 }
 
-template<typename R>
-template<typename F>
-inline ThreadPool<R>::ThreadPool(const F& init_fn, std::size_t N, std::size_t max_jobs_) noexcept : max_jobs(max_jobs_)
+template<typename R, class S, class St, class W, bool Sa>
+inline void ThreadPool<R, S, St, W, Sa>::stop() noexcept
 {
-    for (std::size_t i = 0; i < N; ++i) {
-        workers.emplace_back( [this, init_fn] { // init_fn must be copyable
-            init_fn();
-            worker_loop();
-        });
+    stop_.store(true);
+    scheduler_.close();
+    for (std::size_t i = 0; i < nb_slots_; ++i) {
+        workers_[i].inbox.close();
     }
+    wake_all();
 }
 
-template<typename R>
-inline void ThreadPool<R>::stop() noexcept
+template<typename R, class S, class St, class W, bool Sa>
+inline void ThreadPool<R, S, St, W, Sa>::stop_now() noexcept
 {
-    {
-        std::scoped_lock lk(mutex_);
-        stop_ = true;
+    stop_.store(true);
+    discard_.store(true);
+    scheduler_.close();
+    auto n = scheduler_.clear();
+    for (std::size_t i = 0; i < nb_slots_; ++i) {
+        workers_[i].inbox.close();
+        const auto m = workers_[i].inbox.clear();
+        workers_[i].inbox_size.fetch_sub(m, std::memory_order_relaxed);
+        n += m;
     }
-    cond.notify_all();
-    if (max_jobs) cond_enqueue.notify_all();
+    if (n) finish_tasks(n);
+    wake_all();
 }
 
-template<typename R>
-inline void ThreadPool<R>::stop_now() noexcept
+template<typename R, class S, class St, class W, bool Sa>
+inline ThreadPool<R, S, St, W, Sa>::~ThreadPool() noexcept
 {
+    stop();
     {
-        std::scoped_lock lk(mutex_);
-        stop_ = true;
-        tasks.clear();
-        if (nb_working == 0) {
-            working_cond.notify_all();
+        std::scoped_lock lk(grow_mutex_); // No worker is spawned after this
+    }
+    for (std::size_t i = 0; i < nb_slots_; ++i) {
+        if (workers_[i].thread.joinable()) {
+            workers_[i].thread.join();
         }
     }
-    cond.notify_all();
-    if (max_jobs) cond_enqueue.notify_all();
 }
 
-template<typename R>
-inline ThreadPool<R>::~ThreadPool() noexcept
+template<typename R, class S, class St, class W, bool Sa>
+inline ThreadPoolStats ThreadPool<R, S, St, W, Sa>::stats() const
 {
-    stop();
-    for (auto& worker : workers) {
-        worker.join();
+    static_assert(has_stats, "stats() requires a ThreadPool with Stats = true");
+    ThreadPoolStats ret;
+    ret.workers.reserve(nb_slots_ + 1);
+    std::uint64_t started = 0, executed = 0;
+    for (std::size_t i = 0; i <= nb_slots_; ++i) {
+        executed += stats_[i].executed.load(std::memory_order_acquire); // Before `started`, so that we don't count negative
+        started += stats_[i].started.load(std::memory_order_relaxed);
+        ret.workers.push_back(stats_[i].load());
     }
+    ret.running = static_cast<std::size_t>(started - executed);
+    const auto in_flight = in_flight_.load();
+    ret.queued = in_flight > ret.running ? in_flight - ret.running : 0;
+    return ret;
 }
 
-template<typename R>
-inline void ThreadPool<R>::wait_all() noexcept
+template<typename R, class S, class St, class W, bool Sa>
+inline void ThreadPool<R, S, St, W, Sa>::wait_all() noexcept
 {
-    std::unique_lock lk(mutex_);
-    working_cond.wait(lk, [&] { return nb_working == 0 && tasks.empty(); });
+    std::unique_lock lk(done_mutex_);
+    done_cond_.wait(lk, [&] { return in_flight_.load() == 0; });
 }
 
-template<typename R>
+template<typename R, class S, class St, class W, bool Sa>
+inline bool ThreadPool<R, S, St, W, Sa>::wait_all(const StopToken& token) noexcept
+{
+    // Go through the lock, so that the wake-up can't slip in between checking the token and blocking.
+    StopCallback wake_up(token, [this]() noexcept {
+        {
+            std::scoped_lock lk(done_mutex_);
+        }
+        done_cond_.notify_all();
+    });
+    std::unique_lock lk(done_mutex_);
+    done_cond_.wait(lk, [&] { return in_flight_.load() == 0 || token.stop_requested(); });
+    return in_flight_.load() == 0;
+}
+
+template<typename R, class S, class St, class W, bool Sa>
+template<typename Future>
+inline void ThreadPool<R, S, St, W, Sa>::wait(const Future& fut)
+{
+    while (fut.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        if (!run_pending_task()) {
+            // Nothing to help with. New tasks don't wake us up, so don't block for long.
+            fut.wait_for(std::chrono::microseconds(100));
+        }
+    }
+}
+
+template<typename R, class S, class St, class W, bool Sa>
+template<typename Future>
+inline bool ThreadPool<R, S, St, W, Sa>::wait(const Future& fut, const StopToken& token)
+{
+    // Polls the token as often as wait(fut) polls for new tasks, so no callback is needed.
+    while (fut.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        if (token.stop_requested()) return false;
+        if (!run_pending_task()) {
+            fut.wait_for(std::chrono::microseconds(100));
+        }
+    }
+    return true;
+}
+
+template<typename R, class S, class St, class W, bool Sa>
+inline bool ThreadPool<R, S, St, W, Sa>::run_pending_task()
+{
+    Entry entry;
+    if (!pop_entry(current_worker(), entry)) {
+        return false;
+    }
+    run_task(entry);
+    return true;
+}
+
+template<typename R, class S, class St, class W, bool Sa>
 template<typename F>
-inline void ThreadPool<R>::enqueue(F&& f)
+inline void ThreadPool<R, S, St, W, Sa>::enqueue(F&& f)
 {
     enqueue_task(TaskT(std::forward<F>(f)));
 }
 
-template<typename R>
+template<typename R, class S, class St, class W, bool Sa>
+template<typename F>
+inline bool ThreadPool<R, S, St, W, Sa>::try_enqueue(F&& f)
+{
+    in_flight_.fetch_add(1);
+    if (stop_.load() || !scheduler_.try_push(make_entry(TaskT(std::forward<F>(f))), current_worker())) {
+        finish_tasks(1);
+        return false;
+    }
+    wake_one();
+    maybe_grow();
+    return true;
+}
+
+template<typename R, class S, class St, class W, bool Sa>
 template<typename F>
-inline auto ThreadPool<R>::submit(F&& f)
+inline auto ThreadPool<R, S, St, W, Sa>::submit(F&& f)
 {
-    auto task = TaskT(std::forward<F>(f));
-    auto ret  = task.get_future();
-    enqueue_task(std::move(task));
+    std::future<R> ret;
+    enqueue_task(package(std::forward<F>(f), ret));
     return ret;
 }
 
-template<typename R>
-inline void ThreadPool<R>::enqueue_task(TaskT&& task)
+template<typename R, class S, class St, class W, bool Sa>
+template<typename F>
+inline auto ThreadPool<R, S, St, W, Sa>::submit(Priority prio, F&& f)
 {
-    {
-        std::unique_lock lk(mutex_);
-        if (max_jobs) {
-            cond_enqueue.wait(lk, [&] { return (tasks.size() < max_jobs) || stop_; });
-        }
-        if (stop_) throw EnqueueBlocked{};
-        tasks.emplace_back(std::move(task));
+    static_assert(detail::is_priority_scheduler<S>, "Priorities require the PriorityQueue scheduler");
+    std::future<R> ret;
+    enqueue_task(package(std::forward<F>(f), ret), prio);
+    return ret;
+}
+
+template<typename R, class S, class St, class W, bool Sa>
+template<typename F>
+inline void ThreadPool<R, S, St, W, Sa>::enqueue(Priority prio, F&& f)
+{
+    static_assert(detail::is_priority_scheduler<S>, "Priorities require the PriorityQueue scheduler");
+    enqueue_task(TaskT(std::forward<F>(f)), prio);
+}
+
+template<typename R, class S, class St, class W, bool Sa>
+template<typename F>
+inline auto ThreadPool<R, S, St, W, Sa>::submit_to(std::size_t worker, F&& f)
+{
+    std::future<R> ret;
+    enqueue_task_to(worker, package(std::forward<F>(f), ret));
+    return ret;
+}
+
+template<typename R, class S, class St, class W, bool Sa>
+template<typename F>
+inline void ThreadPool<R, S, St, W, Sa>::enqueue_to(std::size_t worker, F&& f)
+{
+    enqueue_task_to(worker, TaskT(std::forward<F>(f)));
+}
+
+template<typename R, class S, class St, class W, bool Sa>
+template<typename Key, typename F>
+inline auto ThreadPool<R, S, St, W, Sa>::submit_keyed(const Key& key, F&& f)
+{
+    return submit_to(worker_for_key(key), std::forward<F>(f));
+}
+
+template<typename R, class S, class St, class W, bool Sa>
+template<typename Key, typename F>
+inline void ThreadPool<R, S, St, W, Sa>::enqueue_keyed(const Key& key, F&& f)
+{
+    enqueue_to(worker_for_key(key), std::forward<F>(f));
+}
+
+template<typename R, class S, class St, class W, bool Sa>
+template<typename It>
+inline void ThreadPool<R, S, St, W, Sa>::enqueue_bulk(It first, It last)
+{
+    std::vector<Entry> entries;
+    for (; first != last; ++first) {
+        entries.push_back(make_entry(TaskT(*first)));
+    }
+    enqueue_tasks(entries.data(), entries.size());
+}
+
+template<typename R, class S, class St, class W, bool Sa>
+template<typename It>
+inline auto ThreadPool<R, S, St, W, Sa>::submit_bulk(It first, It last)
+{
+    std::vector<Entry>          entries;
+    std::vector<std::future<R>> ret;
+    for (; first != last; ++first) {
+        entries.push_back(make_entry(package(*first, ret.emplace_back())));
+    }
+    enqueue_tasks(entries.data(), entries.size());
+    return ret;
+}
+
+template<typename R, class S, class St, class W, bool Sa>
+template<typename F>
+inline auto ThreadPool<R, S, St, W, Sa>::package(F&& f, std::future<R>& fut) -> TaskT
+{
+    if constexpr (is_packaged) {
+        auto task = TaskT(std::forward<F>(f));
+        fut       = task.get_future();
+        return task;
+    } else {
+        std::promise<R> promise;
+        fut = promise.get_future();
+        return TaskT([promise = std::move(promise), f = std::forward<F>(f)]() mutable {
+            try {
+                if constexpr (std::is_void_v<R>) {
+                    f();
+                    promise.set_value();
+                } else {
+                    promise.set_value(f());
+                }
+            } catch (...) {
+                promise.set_exception(std::current_exception());
+            }
+        });
+    }
+}
+
+template<typename R, class S, class St, class W, bool Sa>
+template<typename... Prio>
+inline void ThreadPool<R, S, St, W, Sa>::enqueue_task(TaskT&& task, Prio... prio)
+{
+    // Count the task before checking stop_, so that workers cannot exit while we're still pushing it.
+    in_flight_.fetch_add(1);
+    if (stop_.load() || !scheduler_.push(make_entry(std::move(task)), current_worker(), prio...)) {
+        finish_tasks(1);
+        throw EnqueueBlocked{};
+    }
+    wake_one();
+    maybe_grow();
+}
+
+template<typename R, class S, class St, class W, bool Sa>
+inline void ThreadPool<R, S, St, W, Sa>::enqueue_task_to(std::size_t worker, TaskT&& task)
+{
+    assert(worker < opts_.min_threads);
+    auto& w = workers_[worker];
+    in_flight_.fetch_add(1);
+    if (stop_.load() || !w.inbox.push(make_entry(std::move(task)), worker)) {
+        finish_tasks(1);
+        throw EnqueueBlocked{};
+    }
+    w.inbox_size.fetch_add(1);
+    // The permit makes up for any missed check of inbox_size, so there's no need to go through the idle list.
+    w.parker.unpark();
+}
+
+template<typename R, class S, class St, class W, bool Sa>
+inline void ThreadPool<R, S, St, W, Sa>::enqueue_tasks(Entry* entries, std::size_t n)
+{
+    if (n == 0) return;
+    in_flight_.fetch_add(n);
+    // Wake workers for the tasks pushed so far, before the scheduler blocks on a full queue, and at the end.
+    std::size_t nb_woken = 0;
+    auto        wake     = [&](std::size_t pushed) {
+        if (pushed > nb_woken) wake_some(pushed - nb_woken);
+        nb_woken = pushed;
+    };
+    const auto pushed = stop_.load() ? 0 : scheduler_.push_bulk(entries, n, current_worker(), wake);
+    wake(pushed);
+    if (pushed) maybe_grow();
+    if (pushed != n) {
+        finish_tasks(n - pushed);
+        throw EnqueueBlocked{};
     }
-    cond.notify_one();
 }
 
 } // namespace clst
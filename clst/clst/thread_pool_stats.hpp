@@ -0,0 +1,145 @@
+#ifndef CLST_THREAD_POOL_STATS_HPP
+#define CLST_THREAD_POOL_STATS_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "clst/detail/cache_line.hpp"
+
+namespace clst {
+
+/**
+ * Snapshot of the statistics of a ThreadPool, see ThreadPool::stats().
+ *
+ * Counters are read one by one without stopping the pool, so a snapshot taken under load is only approximately consistent.
+ */
+struct ThreadPoolStats {
+    // Durations, in log2 buckets: Bucket i counts durations in [2^i, 2^(i+1)) nanoseconds. The last bucket takes the rest.
+    struct Histogram {
+        static constexpr std::size_t nb_buckets = 40;
+
+        std::array<std::uint64_t, nb_buckets> buckets{};
+
+        std::uint64_t count() const noexcept
+        {
+            std::uint64_t n = 0;
+            for (auto b : buckets) n += b;
+            return n;
+        }
+
+        // Upper bound of the bucket containing the q-quantile (0 <= q <= 1). Zero if empty.
+        std::chrono::nanoseconds quantile(double q) const noexcept
+        {
+            const auto n = count();
+            if (n == 0) return std::chrono::nanoseconds(0);
+            const auto    rank = static_cast<std::uint64_t>(q * static_cast<double>(n - 1)) + 1;
+            std::uint64_t seen = 0;
+            std::size_t   i    = 0;
+            for (; i + 1 < nb_buckets; ++i) {
+                seen += buckets[i];
+                if (seen >= rank) break;
+            }
+            return std::chrono::nanoseconds(std::int64_t(2) << i);
+        }
+
+        Histogram& operator+=(const Histogram& other) noexcept
+        {
+            for (std::size_t i = 0; i < nb_buckets; ++i) buckets[i] += other.buckets[i];
+            return *this;
+        }
+    };
+
+    struct Worker {
+        std::uint64_t executed = 0; // Tasks run
+        std::uint64_t steals   = 0; // Tasks taken from another worker (WorkStealing only)
+        std::uint64_t parks    = 0; // Times the worker went to sleep for lack of tasks
+        Histogram     queue_wait;   // From enqueue to start
+        Histogram     run_time;
+
+        Worker& operator+=(const Worker& other) noexcept
+        {
+            executed += other.executed;
+            steals += other.steals;
+            parks += other.parks;
+            queue_wait += other.queue_wait;
+            run_time += other.run_time;
+            return *this;
+        }
+    };
+
+    // One entry per worker, followed by one for threads outside the pool helping through run_pending_task() or wait().
+    std::vector<Worker> workers;
+    std::size_t         queued  = 0; // Tasks waiting in the queue
+    std::size_t         running = 0; // Tasks being run
+
+    Worker total() const noexcept
+    {
+        Worker ret;
+        for (const auto& w : workers) ret += w;
+        return ret;
+    }
+};
+
+namespace detail {
+
+// Live counterpart of ThreadPoolStats::Histogram.
+class AtomicHistogram {
+public:
+    void record(std::chrono::steady_clock::duration d) noexcept
+    {
+        auto        ns = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count());
+        std::size_t i  = 0;
+        while (ns >>= 1) ++i;
+        if (i >= ThreadPoolStats::Histogram::nb_buckets) i = ThreadPoolStats::Histogram::nb_buckets - 1;
+        buckets_[i].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    ThreadPoolStats::Histogram load() const noexcept
+    {
+        ThreadPoolStats::Histogram ret;
+        for (std::size_t i = 0; i < ret.nb_buckets; ++i) {
+            ret.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+        }
+        return ret;
+    }
+
+private:
+    std::array<std::atomic<std::uint64_t>, ThreadPoolStats::Histogram::nb_buckets> buckets_{};
+};
+
+// Live counterpart of ThreadPoolStats::Worker. Mostly written by a single thread, so relaxed increments don't contend.
+struct alignas(cache_line_size) WorkerStats {
+    std::atomic<std::uint64_t> started{0};
+    std::atomic<std::uint64_t> executed{0};
+    std::atomic<std::uint64_t> steals{0};
+    std::atomic<std::uint64_t> parks{0};
+    AtomicHistogram            queue_wait;
+    AtomicHistogram            run_time;
+
+    ThreadPoolStats::Worker load() const noexcept
+    {
+        ThreadPoolStats::Worker ret;
+        ret.executed   = executed.load(std::memory_order_relaxed);
+        ret.steals     = steals.load(std::memory_order_relaxed);
+        ret.parks      = parks.load(std::memory_order_relaxed);
+        ret.queue_wait = queue_wait.load();
+        ret.run_time   = run_time.load();
+        return ret;
+    }
+};
+
+// A task, and when it was enqueued.
+template<class TaskT>
+struct StampedTask {
+    TaskT                                 task;
+    std::chrono::steady_clock::time_point enqueued;
+};
+
+} // namespace detail
+
+} // namespace clst
+
+#endif // CLST_THREAD_POOL_STATS_HPP
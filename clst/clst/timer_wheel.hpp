@@ -0,0 +1,349 @@
+#ifndef CLST_TIMER_WHEEL_HPP
+#define CLST_TIMER_WHEEL_HPP
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "clst/move_only_function.hpp"
+#include "clst/timer.hpp"
+
+namespace clst {
+
+/**
+ * Delayed and periodic callbacks, run on a ThreadPool<void> when due.
+ *
+ * Timers live in a hashed hierarchical wheel: 4 levels of 256 slots, each level counting in units of 256 ticks
+ * of the level below. Scheduling and cancelling are O(1). A tick only looks at one slot, and once every 256 ticks
+ * moves the timers of one higher-level slot down. A background thread drives the wheel, and sleeps until the next
+ * non-empty slot (or forever if there are no timers).
+ *
+ * Callbacks are enqueued on the pool at the first tick at or after their deadline, so they fire up to one tick late.
+ * Timers further out than 2^32 ticks are re-filed as they get closer.
+ *
+ * Timer nodes are kept in a slab, and recycled. A Handle holds a generation number, so that cancelling a timer
+ * that has already fired (even if its node has been reused since) does nothing.
+ */
+template<class Pool, class Clock = typename Timer<>::ClockType>
+class TimerWheel {
+    static_assert(std::is_void_v<typename Pool::ReturnType>, "TimerWheel requires a ThreadPool<void>");
+
+public:
+    using ClockType = Clock;
+    using Duration  = typename Clock::duration;
+    using TimePoint = typename Clock::time_point;
+
+    struct Handle {
+        std::uint32_t index      = nil;
+        std::uint32_t generation = 0;
+    };
+
+    explicit TimerWheel(Pool& pool, Duration tick = std::chrono::milliseconds(1))
+    : pool_(pool), tick_(tick), start_(Clock::now())
+    {
+        heads_.fill(nil);
+        thread_ = std::thread([this] { run(); });
+    }
+
+    // Pending timers are dropped. Callbacks already handed to the pool still run.
+    ~TimerWheel()
+    {
+        {
+            std::scoped_lock lk(mutex_);
+            stop_ = true;
+        }
+        cond_.notify_one();
+        thread_.join();
+    }
+
+    TimerWheel(const TimerWheel&)            = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    template<typename F>
+    Handle schedule_at(TimePoint when, F&& f)
+    {
+        return add(ticks_until(when), 0, Callback(std::forward<F>(f)), nullptr);
+    }
+
+    template<typename F>
+    Handle schedule_after(Duration delay, F&& f)
+    {
+        return schedule_at(Clock::now() + delay, std::forward<F>(f));
+    }
+
+    /**
+     * Run `f` every `period`, starting one period from now, until cancelled.
+     * A run that outlasts the period doesn't delay the next one, so runs of the same timer may overlap.
+     */
+    template<typename F>
+    Handle schedule_every(Duration period, F&& f)
+    {
+        const auto ticks = std::max<std::uint64_t>(1, ceil_div(period.count(), tick_.count()));
+        return add(ticks_until(Clock::now() + period), ticks, Callback{},
+                   std::make_shared<MoveOnlyFunction<void()>>(std::forward<F>(f)));
+    }
+
+    /**
+     * Returns false if the timer had already fired (for a one-shot timer), or been cancelled.
+     * Runs of a periodic timer that are already in the pool are not recalled.
+     */
+    bool cancel(Handle h)
+    {
+        std::scoped_lock lk(mutex_);
+        if (h.index >= nodes_.size() || nodes_[h.index].generation != h.generation || !nodes_[h.index].armed) {
+            return false;
+        }
+        unlink(h.index);
+        release(h.index);
+        return true;
+    }
+
+    // Number of pending timers.
+    std::size_t size()
+    {
+        std::scoped_lock lk(mutex_);
+        return size_;
+    }
+
+private:
+    using Callback = MoveOnlyFunction<void(), 24>;
+
+    static constexpr std::uint32_t nil        = static_cast<std::uint32_t>(-1);
+    static constexpr unsigned      slot_bits  = 8;
+    static constexpr std::size_t   nb_slots   = std::size_t(1) << slot_bits;
+    static constexpr std::size_t   nb_levels  = 4;
+    static constexpr std::uint64_t max_ahead  = (std::uint64_t(1) << (slot_bits * nb_levels)) - 1;
+
+    struct Node {
+        std::uint32_t next       = nil;
+        std::uint32_t prev       = nil;
+        std::uint32_t generation = 0;
+        std::uint16_t list       = 0; // level * nb_slots + slot
+        bool          armed      = false;
+        std::uint64_t expiry     = 0; // Tick
+        std::uint64_t period     = 0; // Ticks, 0 for one-shot timers
+        Callback      fn;
+        std::shared_ptr<MoveOnlyFunction<void()>> periodic_fn; // Shared with the runs in the pool
+    };
+
+    Pool&     pool_;
+    Duration  tick_;
+    TimePoint start_;
+
+    std::mutex              mutex_;
+    std::condition_variable cond_;
+    bool                    stop_ = false;
+
+    std::deque<Node>                                 nodes_; // Slab, never shrinks
+    std::vector<std::uint32_t>                       free_;
+    std::array<std::uint32_t, nb_levels * nb_slots>  heads_;
+    std::array<std::uint64_t, nb_slots / 64>         occupied_{}; // Non-empty slots of level 0
+    std::uint64_t                                    now_ = 0;    // Last processed tick
+    std::size_t                                      size_ = 0;
+    std::uint64_t                                    wakeup_ = 0; // Tick the driver sleeps until
+
+    std::thread thread_;
+
+    static std::uint64_t ceil_div(typename Duration::rep a, typename Duration::rep b) noexcept
+    {
+        return a <= 0 ? 0 : static_cast<std::uint64_t>((a + b - 1) / b);
+    }
+
+    // First tick at or after `when`.
+    std::uint64_t ticks_until(TimePoint when) const noexcept
+    {
+        return ceil_div((when - start_).count(), tick_.count());
+    }
+
+    // Ticks fully elapsed by now.
+    std::uint64_t elapsed() const noexcept
+    {
+        const auto d = (Clock::now() - start_).count();
+        return d <= 0 ? 0 : static_cast<std::uint64_t>(d / tick_.count());
+    }
+
+    Handle add(std::uint64_t expiry, std::uint64_t period, Callback&& fn,
+               std::shared_ptr<MoveOnlyFunction<void()>>&& periodic_fn)
+    {
+        Handle ret;
+        bool   wake;
+        {
+            std::scoped_lock lk(mutex_);
+            std::uint32_t idx;
+            if (!free_.empty()) {
+                idx = free_.back();
+                free_.pop_back();
+            } else {
+                idx = static_cast<std::uint32_t>(nodes_.size());
+                nodes_.emplace_back();
+            }
+            auto& node       = nodes_[idx];
+            node.expiry      = expiry;
+            node.period      = period;
+            node.fn          = std::move(fn);
+            node.periodic_fn = std::move(periodic_fn);
+            node.armed       = true;
+
+            if (size_ == 0) {
+                now_ = std::max(now_, elapsed()); // The driver doesn't tick an empty wheel
+            }
+            ++size_;
+            link(idx);
+            ret  = {idx, node.generation};
+            wake = expiry < wakeup_; // The driver is sleeping past this deadline
+        }
+        if (wake) cond_.notify_one();
+        return ret;
+    }
+
+    void release(std::uint32_t idx)
+    {
+        auto& node = nodes_[idx];
+        node.armed = false;
+        node.fn    = Callback{};
+        node.periodic_fn.reset();
+        ++node.generation;
+        --size_;
+        free_.push_back(idx);
+    }
+
+    void link(std::uint32_t idx)
+    {
+        auto& node = nodes_[idx];
+        // Due (or overdue) timers fire at the next tick.
+        auto expiry      = std::max(node.expiry, now_ + 1);
+        const auto delta = expiry - now_;
+        std::size_t level = 0;
+        while (level + 1 < nb_levels && delta >> (slot_bits * (level + 1)) != 0) ++level;
+        if (delta > max_ahead) expiry = now_ + max_ahead; // Re-filed on the way down
+
+        const auto slot = static_cast<std::size_t>((expiry >> (slot_bits * level)) & (nb_slots - 1));
+        const auto list = level * nb_slots + slot;
+        node.list = static_cast<std::uint16_t>(list);
+        node.prev = nil;
+        node.next = heads_[list];
+        if (node.next != nil) nodes_[node.next].prev = idx;
+        heads_[list] = idx;
+        if (level == 0) occupied_[slot / 64] |= std::uint64_t(1) << (slot % 64);
+    }
+
+    void unlink(std::uint32_t idx) noexcept
+    {
+        auto& node = nodes_[idx];
+        if (node.prev != nil) {
+            nodes_[node.prev].next = node.next;
+        } else {
+            heads_[node.list] = node.next;
+            if (node.next == nil && node.list < nb_slots) {
+                occupied_[node.list / 64] &= ~(std::uint64_t(1) << (node.list % 64));
+            }
+        }
+        if (node.next != nil) nodes_[node.next].prev = node.prev;
+    }
+
+    // Detach a whole slot.
+    std::uint32_t take(std::size_t list) noexcept
+    {
+        if (list < nb_slots) occupied_[list / 64] &= ~(std::uint64_t(1) << (list % 64));
+        return std::exchange(heads_[list], nil);
+    }
+
+    void advance(std::vector<Callback>& ready)
+    {
+        const auto t = ++now_;
+        // Every 256^k ticks, move the current slot of level k down.
+        for (std::size_t level = 1; level < nb_levels; ++level) {
+            if ((t & ((std::uint64_t(1) << (slot_bits * level)) - 1)) != 0) break;
+            const auto slot = static_cast<std::size_t>((t >> (slot_bits * level)) & (nb_slots - 1));
+            for (auto idx = take(level * nb_slots + slot); idx != nil;) {
+                const auto next = nodes_[idx].next;
+                link(idx);
+                idx = next;
+            }
+        }
+        for (auto idx = take(t & (nb_slots - 1)); idx != nil;) {
+            auto&      node = nodes_[idx];
+            const auto next = node.next;
+            if (node.expiry > t) {
+                link(idx); // Clamped, see link()
+            } else if (node.period != 0) {
+                ready.emplace_back([fn = node.periodic_fn] { (*fn)(); });
+                node.expiry = t + node.period;
+                link(idx);
+            } else {
+                ready.push_back(std::move(node.fn));
+                release(idx);
+            }
+            idx = next;
+        }
+    }
+
+    // Next tick worth waking up for: The next non-empty slot of level 0, or else the next cascade.
+    std::uint64_t next_wakeup() const noexcept
+    {
+        const auto base = now_ & ~std::uint64_t(nb_slots - 1);
+        for (auto slot = static_cast<std::size_t>(now_ & (nb_slots - 1)) + 1; slot < nb_slots;) {
+            auto bits = occupied_[slot / 64] >> (slot % 64);
+            if (bits != 0) {
+                for (; !(bits & 1); bits >>= 1) ++slot;
+                return base + slot;
+            }
+            slot = (slot / 64 + 1) * 64;
+        }
+        return base + nb_slots;
+    }
+
+    void dispatch(std::vector<Callback>& ready)
+    {
+        for (auto& fn : ready) {
+            try {
+                pool_.enqueue(std::move(fn));
+            } catch (const typename Pool::EnqueueBlocked&) {
+                // Pool stopped: Nothing to run the callback on.
+            }
+        }
+        ready.clear();
+    }
+
+    void run()
+    {
+        std::vector<Callback> ready;
+        std::unique_lock      lk(mutex_);
+        while (!stop_) {
+            if (size_ == 0) {
+                wakeup_ = static_cast<std::uint64_t>(-1);
+                cond_.wait(lk, [&] { return stop_ || size_ != 0; });
+                wakeup_ = 0;
+                continue;
+            }
+            const auto target = elapsed();
+            while (now_ < target && size_ != 0) {
+                advance(ready);
+            }
+            if (!ready.empty()) {
+                lk.unlock();
+                dispatch(ready);
+                lk.lock();
+                continue;
+            }
+            if (size_ != 0) {
+                wakeup_ = next_wakeup();
+                cond_.wait_until(lk, start_ + tick_ * static_cast<typename Duration::rep>(wakeup_));
+                wakeup_ = 0;
+            }
+        }
+    }
+};
+
+} // namespace clst
+
+#endif // CLST_TIMER_WHEEL_HPP
@@ -0,0 +1,508 @@
+#ifndef CLST_WAIT_POLICY_HPP
+#define CLST_WAIT_POLICY_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86) || defined(_M_ARM64))
+#include <intrin.h>
+#endif
+
+/**
+ * Wait policies, shared by ThreadPool workers and Channel consumers/producers.
+ *
+ * A waiting thread first spins `spin_count` times with a CPU pause instruction, then yields `yield_count` times,
+ * and finally parks. On Linux, parking uses a futex directly. Elsewhere, it falls back to a condition variable.
+ *
+ * Spinning trades CPU time for wake-up latency: A thread that is still spinning is handed over work
+ * without any system call, on either side.
+ */
+
+namespace clst {
+
+// Park right away.
+struct BlockingWait {
+    static constexpr unsigned spin_count  = 0;
+    static constexpr unsigned yield_count = 0;
+};
+
+// Spin, then yield, then park.
+template<unsigned Spins = 1024, unsigned Yields = 16>
+struct SpinWait {
+    static constexpr unsigned spin_count  = Spins;
+    static constexpr unsigned yield_count = Yields;
+};
+
+namespace detail {
+
+inline void
+cpu_relax() noexcept
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    _mm_pause();
+#elif defined(_MSC_VER) && defined(_M_ARM64)
+    __yield();
+#elif defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield");
+#endif
+}
+
+// Busy-waiting on a single CPU only delays the thread we're waiting for.
+inline bool
+can_spin() noexcept
+{
+    static const bool ret = std::thread::hardware_concurrency() > 1;
+    return ret;
+}
+
+// Spin, then yield, until `ready()` or the budget of the policy is exhausted. Returns the last result of `ready()`.
+template<typename Policy, typename F>
+bool
+spin_until(F&& ready)
+{
+    const auto nb_spins = Policy::spin_count && can_spin() ? Policy::spin_count : 0u;
+    for (unsigned i = 0; i < nb_spins; ++i) {
+        if (ready()) return true;
+        cpu_relax();
+    }
+    for (unsigned i = 0; i < Policy::yield_count; ++i) {
+        if (ready()) return true;
+        std::this_thread::yield();
+    }
+    return ready();
+}
+
+#if defined(__linux__)
+#define CLST_HAS_FUTEX 1
+
+static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t));
+
+// Block while *addr == expected, or until woken up (possibly spuriously).
+void futex_wait(std::atomic<std::uint32_t>* addr, std::uint32_t expected) noexcept;
+// As futex_wait(), giving up after `timeout`.
+void futex_wait_for(std::atomic<std::uint32_t>* addr, std::uint32_t expected, std::chrono::nanoseconds timeout) noexcept;
+// Wake up to `count` threads blocked on addr.
+void futex_wake(std::atomic<std::uint32_t>* addr, int count) noexcept;
+#endif
+
+/**
+ * Single-use wake-up token for one thread. unpark() before park() makes the next park() return immediately.
+ */
+template<typename Policy>
+class Parker {
+public:
+#ifdef CLST_HAS_FUTEX
+    void park() noexcept
+    {
+        spin_until<Policy>([&] { return state_.load(std::memory_order_relaxed) == notified; });
+        // Either consume the notification (notified -> empty), or announce that we're going to sleep (empty -> parked).
+        if (state_.fetch_sub(1, std::memory_order_acquire) == notified) return;
+        for (;;) {
+            futex_wait(&state_, parked);
+            std::uint32_t expected = notified;
+            if (state_.compare_exchange_strong(expected, empty, std::memory_order_acquire, std::memory_order_relaxed)) return;
+        }
+    }
+
+    // Returns false if the deadline passed without a wake-up.
+    template<typename Clock, typename Duration>
+    bool park_until(const std::chrono::time_point<Clock, Duration>& deadline) noexcept
+    {
+        spin_until<Policy>([&] { return state_.load(std::memory_order_relaxed) == notified; });
+        if (state_.fetch_sub(1, std::memory_order_acquire) == notified) return true;
+        for (;;) {
+            const auto left = deadline - Clock::now();
+            if (left <= left.zero()) {
+                // Withdraw, unless a wake-up came in meanwhile.
+                return state_.exchange(empty, std::memory_order_acquire) == notified;
+            }
+            futex_wait_for(&state_, parked, std::chrono::duration_cast<std::chrono::nanoseconds>(left));
+            std::uint32_t expected = notified;
+            if (state_.compare_exchange_strong(expected, empty, std::memory_order_acquire, std::memory_order_relaxed)) return true;
+        }
+    }
+
+    void unpark() noexcept
+    {
+        if (state_.exchange(notified, std::memory_order_release) == parked) {
+            futex_wake(&state_, 1);
+        }
+    }
+
+private:
+    static constexpr std::uint32_t empty    = 0;
+    static constexpr std::uint32_t notified = 1;
+    static constexpr std::uint32_t parked   = static_cast<std::uint32_t>(-1);
+
+    std::atomic<std::uint32_t> state_{empty};
+#else
+    void park()
+    {
+        spin_until<Policy>([&] { return permit_hint_.load(std::memory_order_relaxed); });
+        std::unique_lock lk(mutex_);
+        cond_.wait(lk, [&] { return permit_; });
+        permit_ = false;
+        permit_hint_.store(false, std::memory_order_relaxed);
+    }
+
+    template<typename Clock, typename Duration>
+    bool park_until(const std::chrono::time_point<Clock, Duration>& deadline)
+    {
+        spin_until<Policy>([&] { return permit_hint_.load(std::memory_order_relaxed); });
+        std::unique_lock lk(mutex_);
+        if (!cond_.wait_until(lk, deadline, [&] { return permit_; })) return false;
+        permit_ = false;
+        permit_hint_.store(false, std::memory_order_relaxed);
+        return true;
+    }
+
+    void unpark()
+    {
+        {
+            std::scoped_lock lk(mutex_);
+            permit_ = true;
+            permit_hint_.store(true, std::memory_order_relaxed);
+        }
+        cond_.notify_one();
+    }
+
+private:
+    std::mutex              mutex_;
+    std::condition_variable cond_;
+    bool                    permit_ = false;
+    std::atomic<bool>       permit_hint_{false}; // For spinning without the lock
+#endif
+};
+
+/**
+ * Condition variable replacement, for use with a std::unique_lock<std::mutex>.
+ *
+ * Every notification bumps a sequence number. Waiters spin on it (outside the lock) according to the policy,
+ * before parking on it. Notifiers only make a system call if some waiter is actually parked.
+ */
+template<typename Policy>
+class WaitEvent {
+public:
+    template<typename Pred>
+    void wait(std::unique_lock<std::mutex>& lk, Pred pred)
+    {
+        while (!pred()) {
+            // Read under the lock: Any state change after this point comes with a new sequence number.
+            const auto seq = seq_.load(std::memory_order_relaxed);
+            lk.unlock();
+            if (!spin_until<Policy>([&] { return seq_.load(std::memory_order_relaxed) != seq; })) {
+                park(seq);
+            }
+            lk.lock();
+        }
+    }
+
+    // As wait(), giving up at `deadline`. Returns the last result of `pred()`.
+    template<typename Clock, typename Duration, typename Pred>
+    bool
+    wait_until(std::unique_lock<std::mutex>& lk, const std::chrono::time_point<Clock, Duration>& deadline, Pred pred)
+    {
+        while (!pred()) {
+            if (Clock::now() >= deadline) return false;
+            const auto seq = seq_.load(std::memory_order_relaxed);
+            lk.unlock();
+            if (!spin_until<Policy>([&] { return seq_.load(std::memory_order_relaxed) != seq; })) {
+                park_until(seq, deadline);
+            }
+            lk.lock();
+        }
+        return true;
+    }
+
+    void notify_one() noexcept
+    {
+        wake(1);
+    }
+
+    void notify_all() noexcept
+    {
+        wake(INT32_MAX);
+    }
+
+    // Wake up to `count` waiters.
+    void notify(std::size_t count) noexcept
+    {
+        if (count != 0) wake(count < INT32_MAX ? static_cast<int>(count) : INT32_MAX);
+    }
+
+private:
+    std::atomic<std::uint32_t> seq_{0};
+    std::atomic<std::uint32_t> nb_parked_{0};
+
+#ifdef CLST_HAS_FUTEX
+    void park(std::uint32_t seq) noexcept
+    {
+        nb_parked_.fetch_add(1);
+        futex_wait(&seq_, seq); // Returns right away if seq_ has already moved on
+        nb_parked_.fetch_sub(1);
+    }
+
+    template<typename Clock, typename Duration>
+    void park_until(std::uint32_t seq, const std::chrono::time_point<Clock, Duration>& deadline) noexcept
+    {
+        const auto left = deadline - Clock::now();
+        if (left <= left.zero()) return;
+        nb_parked_.fetch_add(1);
+        futex_wait_for(&seq_, seq, std::chrono::duration_cast<std::chrono::nanoseconds>(left));
+        nb_parked_.fetch_sub(1);
+    }
+
+    void wake(int count) noexcept
+    {
+        seq_.fetch_add(1);
+        if (nb_parked_.load() != 0) {
+            futex_wake(&seq_, count);
+        }
+    }
+#else
+    std::mutex              mutex_;
+    std::condition_variable cond_;
+
+    void park(std::uint32_t seq)
+    {
+        std::unique_lock lk(mutex_);
+        nb_parked_.fetch_add(1);
+        cond_.wait(lk, [&] { return seq_.load() != seq; });
+        nb_parked_.fetch_sub(1);
+    }
+
+    template<typename Clock, typename Duration>
+    void park_until(std::uint32_t seq, const std::chrono::time_point<Clock, Duration>& deadline)
+    {
+        std::unique_lock lk(mutex_);
+        nb_parked_.fetch_add(1);
+        cond_.wait_until(lk, deadline, [&] { return seq_.load() != seq; });
+        nb_parked_.fetch_sub(1);
+    }
+
+    void wake(int count)
+    {
+        seq_.fetch_add(1);
+        if (nb_parked_.load() != 0) {
+            {
+                std::scoped_lock lk(mutex_);
+            }
+            if (count == 1) {
+                cond_.notify_one();
+            } else {
+                cond_.notify_all();
+            }
+        }
+    }
+#endif
+};
+
+/**
+ * Lock-free counterpart of WaitEvent, for waiting on state that is changed without a lock.
+ *
+ * Waiters queue up before re-checking their condition, and notifiers look for waiters after changing the state,
+ * with a full fence in between. So a notification can't slip past a waiter, and a notifier with nobody waiting only
+ * pays for the fence. The queue itself is guarded by a mutex.
+ *
+ * A notification takes the waiter it wakes up off the queue. So a burst of notifications doesn't keep waking up
+ * the same thread before it gets going, and notify_one() doesn't cause a thundering herd.
+ */
+template<typename Policy>
+class EventCount {
+public:
+    // Block until `ready()` returns true. `ready` may have side effects, such as taking an item.
+    template<typename Pred>
+    void wait(Pred&& ready)
+    {
+        if (spin_until<Policy>(ready)) return;
+        Waiter self;
+        for (;;) {
+            enqueue(&self);
+            if (ready()) {
+                withdraw(&self);
+                return;
+            }
+            self.parker->park();
+            if (ready()) return;
+        }
+    }
+
+    // As wait(), giving up at `deadline`. Returns the last result of `ready()`.
+    template<typename Clock, typename Duration, typename Pred>
+    bool wait_until(const std::chrono::time_point<Clock, Duration>& deadline, Pred&& ready)
+    {
+        if (spin_until<Policy>(ready)) return true;
+        Waiter self;
+        for (;;) {
+            enqueue(&self);
+            if (ready()) {
+                withdraw(&self);
+                return true;
+            }
+            if (!self.parker->park_until(deadline)) {
+                withdraw(&self);
+                return ready();
+            }
+            if (ready()) return true;
+        }
+    }
+
+    // Call after changing the state.
+    void notify_one() noexcept
+    {
+        if (!has_waiters()) return;
+        Waiter* w;
+        {
+            std::scoped_lock lk(mutex_);
+            w = head_;
+            if (!w) return;
+            unlink(w);
+        }
+        w->parker->unpark();
+    }
+
+    void notify_all() noexcept
+    {
+        if (!has_waiters()) return;
+        Waiter* w;
+        {
+            std::scoped_lock lk(mutex_);
+            w = std::exchange(head_, nullptr);
+            tail_ = nullptr;
+            for (auto* p = w; p; p = p->next) {
+                p->queued = false;
+                nb_waiting_.fetch_sub(1, std::memory_order_relaxed);
+            }
+        }
+        unpark_all(w);
+    }
+
+    // Wake up to `count` waiters, in the order they came in. For a batch of `count` state changes.
+    void notify(std::size_t count) noexcept
+    {
+        if (count == 0 || !has_waiters()) return;
+        Waiter* w;
+        {
+            std::scoped_lock lk(mutex_);
+            w = head_;
+            auto* last = w;
+            for (std::size_t i = 1; last && i < count; ++i) last = last->next;
+            if (!last) {
+                head_ = nullptr;
+                tail_ = nullptr;
+            } else {
+                head_ = last->next;
+                if (head_) {
+                    head_->prev = nullptr;
+                } else {
+                    tail_ = nullptr;
+                }
+                last->next = nullptr;
+            }
+            for (auto* p = w; p; p = p->next) {
+                p->queued = false;
+                nb_waiting_.fetch_sub(1, std::memory_order_relaxed);
+            }
+        }
+        unpark_all(w);
+    }
+
+private:
+    struct Waiter {
+        Waiter* next   = nullptr;
+        Waiter* prev   = nullptr;
+        bool    queued = false;
+        // Outlives the waiter, as notifiers unpark it after letting go of the lock.
+        Parker<BlockingWait>* parker = &thread_parker();
+    };
+
+    std::atomic<std::uint32_t> nb_waiting_{0};
+    std::mutex                 mutex_;
+    Waiter*                    head_ = nullptr;
+    Waiter*                    tail_ = nullptr;
+
+    static Parker<BlockingWait>& thread_parker() noexcept
+    {
+        static thread_local Parker<BlockingWait> parker;
+        return parker;
+    }
+
+    static void unpark_all(Waiter* w) noexcept
+    {
+        while (w) {
+            auto* const next = w->next; // w is gone once woken up
+            w->parker->unpark();
+            w = next;
+        }
+    }
+
+    bool has_waiters() noexcept
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return nb_waiting_.load(std::memory_order_relaxed) != 0;
+    }
+
+    void enqueue(Waiter* w)
+    {
+        std::scoped_lock lk(mutex_);
+        w->next   = nullptr;
+        w->prev   = tail_;
+        w->queued = true;
+        if (tail_) {
+            tail_->next = w;
+        } else {
+            head_ = w;
+        }
+        tail_ = w;
+        nb_waiting_.fetch_add(1);
+    }
+
+    // Returns false if a notifier took `w` off already.
+    bool dequeue(Waiter* w)
+    {
+        std::scoped_lock lk(mutex_);
+        if (!w->queued) return false;
+        unlink(w);
+        return true;
+    }
+
+    // Leave the queue without having parked.
+    void withdraw(Waiter* w)
+    {
+        if (!dequeue(w)) {
+            // A notifier took us off meanwhile: Take its wake-up, and pass it on.
+            w->parker->park();
+            notify_one();
+        }
+    }
+
+    void unlink(Waiter* w) noexcept
+    {
+        if (w->prev) {
+            w->prev->next = w->next;
+        } else {
+            head_ = w->next;
+        }
+        if (w->next) {
+            w->next->prev = w->prev;
+        } else {
+            tail_ = w->prev;
+        }
+        w->queued = false;
+        nb_waiting_.fetch_sub(1, std::memory_order_relaxed);
+    }
+};
+
+} // namespace detail
+
+} // namespace clst
+
+#endif // CLST_WAIT_POLICY_HPP
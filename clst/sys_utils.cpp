@@ -21,8 +21,11 @@
 #ifdef __linux__
 #include <fstream> // for parsing /proc/meminfo
 #include <cstdio>  // sscanf
+#include <sched.h> // sched_{get,set}affinity
 #endif
 
+#include <thread>
+
 #if defined(__APPLE__) && defined(__MACH__)
 #include <mach-o/dyld.h>   // _NSGetExecutablePath
 #include <sys/syslimits.h> // PATH_MAX
@@ -123,4 +126,58 @@ get_mem_info()
 #endif
 }
 
+#ifdef __linux__
+static unsigned
+read_topology_id(unsigned cpu, const char* name, unsigned fallback)
+{
+    std::ifstream f("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/" + name);
+    unsigned id;
+    return f >> id ? id : fallback;
+}
+#endif
+
+std::vector<CpuInfo>
+get_cpu_topology()
+{
+    std::vector<CpuInfo> ret;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) != 0) {
+        SystemError::throw_last();
+    }
+    for (unsigned cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &set)) {
+            // Without sysfs (e.g. in some containers), consider every CPU a core of its own.
+            ret.push_back(CpuInfo{cpu, read_topology_id(cpu, "core_id", cpu), read_topology_id(cpu, "physical_package_id", 0)});
+        }
+    }
+#else
+    const auto n = std::thread::hardware_concurrency();
+    for (unsigned cpu = 0; cpu < n; ++cpu) {
+        ret.push_back(CpuInfo{cpu, cpu, 0});
+    }
+#endif
+    return ret;
+}
+
+void
+set_thread_affinity(unsigned cpu)
+{
+#ifdef __linux__
+    if (cpu >= CPU_SETSIZE) {
+        throw SystemError(std::errc::invalid_argument);
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+        SystemError::throw_last();
+    }
+#else
+    (void)cpu;
+    throw SystemError(std::errc::operation_not_supported);
+#endif
+}
+
 } // namespace clst
@@ -0,0 +1,42 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE // syscall()
+#endif
+
+#include "clst/wait_policy.hpp"
+
+#ifdef CLST_HAS_FUTEX
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <ctime>
+
+namespace clst::detail {
+
+// Private futexes: We never share these across processes.
+
+void
+futex_wait(std::atomic<std::uint32_t>* addr, std::uint32_t expected) noexcept
+{
+    // EAGAIN (value changed) and EINTR are both fine: Callers re-check their condition.
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(addr), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+}
+
+void
+futex_wait_for(std::atomic<std::uint32_t>* addr, std::uint32_t expected, std::chrono::nanoseconds timeout) noexcept
+{
+    // Relative timeout, measured against CLOCK_MONOTONIC.
+    timespec ts;
+    ts.tv_sec  = static_cast<time_t>(timeout.count() / 1000000000);
+    ts.tv_nsec = static_cast<long>(timeout.count() % 1000000000);
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(addr), FUTEX_WAIT_PRIVATE, expected, &ts, nullptr, 0);
+}
+
+void
+futex_wake(std::atomic<std::uint32_t>* addr, int count) noexcept
+{
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(addr), FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+}
+
+} // namespace clst::detail
+
+#endif // CLST_HAS_FUTEX
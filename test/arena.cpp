@@ -19,6 +19,15 @@ int arena(int, char*[])
     CLST_ASSERT(arena.allocate<TestAlign>() != nullptr);
     CLST_ASSERT(arena.capacity() == 0);
     CLST_ASSERT(arena.allocate(1, 1) == nullptr);
+
+    arena.reset();
+    CLST_ASSERT(arena.capacity() == len);
+    CLST_ASSERT(arena.allocate(8, 1) == buf);
+    auto* top = arena.top();
+    CLST_ASSERT(arena.allocate(8, 1) == buf + 8);
+    arena.reset(top);
+    CLST_ASSERT(arena.capacity() == len - 8);
+    CLST_ASSERT(arena.allocate(8, 1) == buf + 8);
     
     return 0;
 }
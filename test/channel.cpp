@@ -1,8 +1,285 @@
 #include <clst/channel.hpp>
+#include <clst/timer.hpp>
 #include "test_macros.h"
+#include <atomic>
+#include <chrono>
+#include <numeric>
 #include <string>
 #include <vector>
 #include <thread>
+#include <cstdio>
+
+namespace {
+
+// Bounded channels hold up to `max_items`, unbounded ones take no size.
+template<class Channel>
+Channel
+make_test_channel(std::size_t max_items)
+{
+    if constexpr (Channel::is_bounded) {
+        return Channel(max_items);
+    } else {
+        return Channel();
+    }
+}
+
+// An item of `Size` bytes, carrying a long.
+template<std::size_t Size>
+struct Payload {
+    long value;
+    char pad[Size - sizeof(long)];
+
+    Payload(long v = 0) noexcept : value(v) {}
+    operator long() const noexcept { return value; }
+};
+
+// Moves may throw, so channels of these don't get the lock-free backends.
+struct ThrowingMove {
+    long value = 0;
+
+    ThrowingMove(long v = 0) : value(v) {}
+    ThrowingMove(ThrowingMove&& other) noexcept(false) : value(other.value) {}
+    ThrowingMove& operator=(ThrowingMove&& other) noexcept(false)
+    {
+        value = other.value;
+        return *this;
+    }
+};
+
+// Average round trip between two threads, in microseconds.
+template<class WaitPolicy>
+double
+bench_ping_pong()
+{
+    static constexpr int nb_rounds = 10000;
+    clst::Channel<int, false, true, true, WaitPolicy> ping, pong;
+    std::thread t {
+        [&] {
+            int i;
+            while (ping.pop(i)) {
+                pong.emplace(i + 1);
+            }
+        }
+    };
+    clst::Timer timer;
+    for (int i = 0; i < nb_rounds; ++i) {
+        ping.emplace(i);
+        CLST_ASSERT(pong.pop() == i + 1);
+    }
+    const auto t_total = timer.toc();
+    ping.close();
+    t.join();
+    return t_total / nb_rounds * 1e6;
+}
+
+// Items per second through an SPSC channel, in millions.
+template<class Channel>
+double
+bench_throughput()
+{
+    static constexpr long nb_items = 1000000;
+    auto ch = make_test_channel<Channel>(1024);
+    clst::Timer timer;
+    std::thread t {
+        [&] {
+            for (long i = 0; i < nb_items; ++i) {
+                ch.emplace(i);
+            }
+            ch.close();
+        }
+    };
+    long sum = 0;
+    typename Channel::value_type item;
+    while (ch.pop(item)) {
+        sum += item;
+    }
+    const auto t_total = timer.toc();
+    t.join();
+    CLST_ASSERT_EQ(sum, nb_items * (nb_items - 1) / 2);
+    return nb_items / t_total * 1e-6;
+}
+
+// Producers race with close(): Every item that emplace() accepted comes out, exactly once.
+template<class Channel>
+void
+test_close_race()
+{
+    static constexpr int nb_threads = 4;
+    auto ch = make_test_channel<Channel>(8);
+    std::atomic<long> accepted{0}, received{0}, nb_received{0};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < nb_threads; ++i) {
+        threads.emplace_back([&] {
+            for (long v = 1; ch.emplace(v); ++v) accepted += v;
+        });
+        if (Channel::is_single_consumer && i != 0) continue;
+        threads.emplace_back([&] {
+            long v;
+            while (ch.pop(v)) {
+                received += v;
+                ++nb_received;
+            }
+        });
+    }
+    while (nb_received.load() < 100000) std::this_thread::yield();
+    ch.close();
+    for (auto& t : threads) t.join();
+    CLST_ASSERT_EQ(received.load(), accepted.load());
+}
+
+// Items per second from 16 producers into one consumer, in millions.
+template<class Channel>
+double
+bench_fan_in()
+{
+    static constexpr int  nb_producers = 16;
+    static constexpr long nb_items     = 20000;
+    auto ch = make_test_channel<Channel>(1024);
+    clst::Timer timer;
+    std::vector<std::thread> producers;
+    for (int i = 0; i < nb_producers; ++i) {
+        producers.emplace_back([&] {
+            for (long i = 0; i < nb_items; ++i) {
+                ch.emplace(i);
+            }
+        });
+    }
+    long sum = 0;
+    for (long i = 0; i < nb_items * nb_producers; ++i) {
+        sum += *ch.pop();
+    }
+    const auto t_total = timer.toc();
+    for (auto& t : producers) t.join();
+    CLST_ASSERT_EQ(sum, nb_producers * (nb_items * (nb_items - 1) / 2));
+    return nb_items * nb_producers / t_total * 1e-6;
+}
+
+// Batches in and out, through a small channel: Items come out once each, in order with a single producer.
+template<class Channel>
+void
+test_batches()
+{
+    static constexpr long nb_items = 100000;
+    auto ch = make_test_channel<Channel>(16);
+    std::thread producer {
+        [&] {
+            std::vector<long> batch(100);
+            for (long i = 0; i < nb_items; i += batch.size()) {
+                std::iota(batch.begin(), batch.end(), i);
+                CLST_ASSERT_EQ(ch.emplace_many(batch.begin(), batch.end()), batch.size());
+            }
+            ch.close();
+        }
+    };
+    std::vector<long> received;
+    while (ch.drain_into(received, 64) != 0) {}
+    producer.join();
+    CLST_ASSERT_EQ(received.size(), std::size_t(nb_items));
+    for (long i = 0; i < nb_items; ++i) CLST_ASSERT_EQ(received[i], i);
+    CLST_ASSERT_EQ(ch.emplace_many(received.begin(), received.end()), std::size_t(0));
+}
+
+// Non-blocking and deadline-aware operations.
+template<class Channel>
+void
+test_polling()
+{
+    using namespace std::chrono_literals;
+    using Clock = std::chrono::steady_clock;
+    auto ch = make_test_channel<Channel>(2);
+    long v = 0;
+    CLST_ASSERT(!ch.try_pop(v));
+    CLST_ASSERT(!ch.try_pop());
+    const auto start = Clock::now();
+    CLST_ASSERT(!ch.pop_for(20ms));
+    CLST_ASSERT(Clock::now() - start >= 20ms);
+
+    CLST_ASSERT(ch.try_emplace(1));
+    CLST_ASSERT(ch.try_emplace(2));
+    if constexpr (Channel::is_bounded) {
+        CLST_ASSERT(!ch.try_emplace(3));
+    }
+    CLST_ASSERT_EQ(ch.try_pop(), std::optional<long>(1));
+    // An item that's there is taken, deadline passed or not.
+    CLST_ASSERT(ch.pop_until(Clock::now() - 1s, v));
+    CLST_ASSERT_EQ(v, 2L);
+
+    // Woken up by an item, well before the deadline.
+    std::thread producer {
+        [&] {
+            std::this_thread::sleep_for(10ms);
+            ch.emplace(4);
+        }
+    };
+    CLST_ASSERT_EQ(ch.pop_for(10s), std::optional<long>(4));
+    producer.join();
+
+    ch.close();
+    CLST_ASSERT(!ch.try_emplace(5));
+    CLST_ASSERT(!ch.pop_for(10s)); // Closed: Returns right away
+}
+
+// A capacity that isn't a power of 2 is still exact, lap after lap.
+template<class Channel>
+void
+test_exact_capacity()
+{
+    auto ch = make_test_channel<Channel>(3);
+    for (int lap = 0; lap < 5; ++lap) {
+        for (int i = 0; i < 3; ++i) CLST_ASSERT(ch.try_emplace(i));
+        CLST_ASSERT(!ch.try_emplace(3));
+        CLST_ASSERT_EQ(ch.size(), std::size_t(3));
+        for (int i = 0; i < 3; ++i) CLST_ASSERT_EQ(ch.try_pop(), std::optional<int>(i));
+        CLST_ASSERT(ch.try_emplace(lap)); // Shift the next lap by one
+        CLST_ASSERT_EQ(ch.try_pop(), std::optional<int>(lap));
+    }
+}
+
+template<class Channel>
+void
+test_throwing_move()
+{
+    auto ch = make_test_channel<Channel>(2);
+    CLST_ASSERT(ch.try_emplace(1));
+    ch.emplace(2);
+    ThrowingMove item;
+    CLST_ASSERT(ch.pop(item));
+    CLST_ASSERT_EQ(item.value, 1L);
+    CLST_ASSERT(ch.pop(item));
+    CLST_ASSERT_EQ(item.value, 2L);
+}
+
+// Items per second through a channel, moved in and out `batch_size` at a time, in millions.
+template<class Channel>
+double
+bench_batched(std::size_t batch_size)
+{
+    static constexpr long nb_items = 1 << 20; // A whole number of batches
+    auto ch = make_test_channel<Channel>(1024);
+    clst::Timer timer;
+    std::thread t {
+        [&] {
+            std::vector<long> batch(batch_size);
+            for (long i = 0; i < nb_items; i += batch_size) {
+                std::iota(batch.begin(), batch.end(), i);
+                ch.emplace_many(batch.begin(), batch.end());
+            }
+            ch.close();
+        }
+    };
+    long sum = 0;
+    std::vector<long> batch;
+    while (ch.drain_into(batch, batch_size) != 0) {
+        sum = std::accumulate(batch.begin(), batch.end(), sum);
+        batch.clear();
+    }
+    const auto t_total = timer.toc();
+    t.join();
+    CLST_ASSERT_EQ(sum, nb_items * (nb_items - 1) / 2);
+    return nb_items / t_total * 1e-6;
+}
+
+} // namespace
 
 int channel(int, char*[])
 {
@@ -48,5 +325,57 @@ int channel(int, char*[])
         CLST_ASSERT(result[i] == (std::string("data ") + std::to_string(i) + " processed"));
     }
 
+    const auto lat_blocking = bench_ping_pong<clst::BlockingWait>();
+    const auto lat_spinning = bench_ping_pong<clst::SpinWait<>>();
+    printf("ping-pong round trip: BlockingWait %.2fus, SpinWait %.2fus\n", lat_blocking, lat_spinning);
+
+    // The SPSC channel is lock-free. Single-producer multi-consumer still goes through the mutex.
+    const auto tp_lock_free = bench_throughput<clst::Channel<long, true, true, true>>();
+    const auto tp_mutex     = bench_throughput<clst::Channel<long, true, true, false>>();
+    const auto tp_unbounded = bench_throughput<clst::Channel<long, false, true, true>>();
+    printf("SPSC throughput: lock-free %.1fM items/s, unbounded lock-free %.1fM items/s, mutex %.1fM items/s\n",
+           tp_lock_free, tp_unbounded, tp_mutex);
+
+    // Bounded channels that go through the mutex keep their items in a ring buffer, whatever their size.
+    const auto tp_small = bench_throughput<clst::Channel<long, true, false, true>>();
+    const auto tp_large = bench_throughput<clst::Channel<Payload<256>, true, false, true>>();
+    printf("bounded MPSC throughput: 8-byte items %.1fM items/s, 256-byte items %.1fM items/s\n", tp_small, tp_large);
+
+    test_close_race<clst::Channel<long>>();
+    test_close_race<clst::Channel<long, true, false, true>>();
+    test_close_race<clst::Channel<long, false, false, true>>();
+
+    // The MPMC and unbounded MPSC channels are lock-free. The bounded MPSC channel still goes through the mutex.
+    const auto fan_in_lock_free = bench_fan_in<clst::Channel<long>>();
+    const auto fan_in_unbounded = bench_fan_in<clst::Channel<long, false, false, true>>();
+    const auto fan_in_mutex     = bench_fan_in<clst::Channel<long, true, false, true>>();
+    printf("16-producer fan-in: lock-free %.1fM items/s, unbounded lock-free %.1fM items/s, mutex %.1fM items/s\n",
+           fan_in_lock_free, fan_in_unbounded, fan_in_mutex);
+
+    test_batches<clst::Channel<long, true, false, true>>();
+    test_batches<clst::Channel<long, false>>();
+    test_batches<clst::Channel<long, true, true, true>>();
+    test_batches<clst::Channel<long>>();
+    test_batches<clst::Channel<long, false, false, true>>();
+
+    test_polling<clst::Channel<long, true, false, true>>();
+    test_polling<clst::Channel<long, false>>();
+    test_polling<clst::Channel<long, true, true, true>>();
+    test_polling<clst::Channel<long>>();
+    test_polling<clst::Channel<long, false, false, true>>();
+
+    test_exact_capacity<clst::Channel<int>>();
+    test_exact_capacity<clst::Channel<int, true, true, true>>();
+    test_exact_capacity<clst::Channel<int, true, false, true>>();
+
+    test_throwing_move<clst::Channel<ThrowingMove>>();
+    test_throwing_move<clst::Channel<ThrowingMove, true, true, true>>();
+    test_throwing_move<clst::Channel<ThrowingMove, false, false, true>>();
+
+    // One lock round trip and one wake-up per batch, rather than per item.
+    const auto batch_1   = bench_batched<clst::Channel<long, true, false, true>>(1);
+    const auto batch_256 = bench_batched<clst::Channel<long, true, false, true>>(256);
+    printf("bounded MPSC throughput: 1 item per call %.1fM items/s, 256 items per call %.1fM items/s\n", batch_1, batch_256);
+
     return 0;
 }
@@ -0,0 +1,122 @@
+#include <clst/builtins.h>
+
+#if CLST_CPP20
+
+#include <clst/coro.hpp>
+#include <clst/channel.hpp>
+#include <clst/thread_pool.hpp>
+#include "test_macros.h"
+#include <atomic>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+using Pool = clst::ThreadPool<void, clst::WorkStealing, clst::InplaceTask<>>;
+
+clst::Task<long, clst::RecycledFrames>
+sum_to(long n)
+{
+    if (n == 0) co_return 0;
+    co_return n + co_await sum_to(n - 1);
+}
+
+clst::Task<int>
+on_worker(Pool& pool)
+{
+    co_await pool.schedule();
+    CLST_ASSERT(pool.is_current_worker());
+    co_return 42;
+}
+
+clst::Task<>
+fail()
+{
+    throw std::runtime_error("oops");
+    co_return;
+}
+
+clst::Task<>
+produce(Pool& pool, clst::Channel<int>& ch, int n)
+{
+    for (int i = 0; i < n; ++i) {
+        CLST_ASSERT(co_await clst::emplace_async(ch, pool, i));
+    }
+    ch.close();
+}
+
+clst::Task<long>
+consume(Pool& pool, clst::Channel<int>& ch)
+{
+    long sum = 0;
+    while (auto item = co_await clst::pop_async(ch, pool)) {
+        sum += *item;
+    }
+    co_return sum;
+}
+
+void
+test_task(Pool& pool)
+{
+    CLST_ASSERT_EQ(clst::spawn(pool, on_worker(pool)).get(), 42);
+    CLST_ASSERT_EQ(clst::spawn(pool, sum_to(1000)).get(), 500500L);
+    CLST_EXPECT_THROW(clst::spawn(pool, fail()).get(), std::runtime_error);
+}
+
+void
+test_channel(Pool& pool)
+{
+    // A tiny channel, so that both sides have to suspend, many times.
+    clst::Channel<int> ch(2);
+    auto consumer = clst::spawn(pool, consume(pool, ch));
+    auto producer = clst::spawn(pool, produce(pool, ch, 10000));
+    producer.get();
+    CLST_ASSERT_EQ(consumer.get(), 49995000L);
+
+    // Threads and coroutines mix on the same channel.
+    clst::Channel<int> mixed(1);
+    auto popped = clst::spawn(pool, consume(pool, mixed));
+    for (int i = 1; i <= 100; ++i) mixed.emplace(i);
+    mixed.close();
+    CLST_ASSERT_EQ(popped.get(), 5050L);
+}
+
+// Thousands of handlers waiting at once, without a thread each.
+void
+test_many_waiting(Pool& pool)
+{
+    static constexpr int n = 5000;
+    clst::Channel<int, false> requests;
+    std::vector<clst::Future<long>> handlers;
+    for (int i = 0; i < n; ++i) {
+        handlers.push_back(clst::spawn(pool, [](Pool& pool, clst::Channel<int, false>& ch) -> clst::Task<long> {
+            auto item = co_await clst::pop_async(ch, pool);
+            co_return item ? *item : -1;
+        }(pool, requests)));
+    }
+    for (int i = 0; i < n; ++i) requests.emplace(1);
+    long total = 0;
+    for (auto& h : handlers) total += h.get();
+    CLST_ASSERT_EQ(total, long(n));
+}
+
+} // namespace
+
+int coro(int, char*[])
+{
+    Pool pool(2);
+    test_task(pool);
+    test_channel(pool);
+    test_many_waiting(pool);
+    return 0;
+}
+
+#else
+
+int coro(int, char*[])
+{
+    return 0; // Requires C++20
+}
+
+#endif
@@ -0,0 +1,170 @@
+#include <clst/future.hpp>
+#include <clst/thread_pool.hpp>
+#include <clst/timer.hpp>
+#include "test_macros.h"
+#include <atomic>
+#include <cstdio>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Pool = clst::ThreadPool<void, clst::WorkStealing, clst::InplaceTask<>>;
+
+void
+test_then(Pool& pool)
+{
+    auto fut = clst::async(pool, [] { return 20; })
+                   .then([](int x) { return x + 1; })
+                   .then([](int x) { return std::to_string(x * 2); });
+    CLST_ASSERT_EQ(fut.get(), std::string("42"));
+    CLST_ASSERT(!fut.valid());
+
+    // Exceptions skip continuations.
+    std::atomic<bool> skipped{true};
+    auto failed = clst::async(pool, []() -> int { throw std::runtime_error("oops"); })
+                      .then([&](int) { skipped = false; })
+                      .then([&] { skipped = false; return 0; });
+    CLST_EXPECT_THROW(failed.get(), std::runtime_error);
+    CLST_ASSERT(skipped.load());
+
+    // Continuations are posted to the pool, not run by set_value(). Otherwise, this would never return.
+    std::promise<void> gate;
+    clst::Promise<int> promise(clst::Executor{pool});
+    auto posted = promise.get_future().then([f = gate.get_future().share()](int x) { f.wait(); return x; });
+    promise.set_value(7);
+    gate.set_value();
+    CLST_ASSERT_EQ(posted.get(), 7);
+
+    auto broken = clst::Promise<void>().get_future();
+    CLST_EXPECT_THROW(broken.get(), std::future_error);
+}
+
+void
+test_when(Pool& pool)
+{
+    std::vector<clst::Future<long>> futures;
+    for (long i = 0; i < 100; ++i) {
+        futures.push_back(clst::async(pool, [i] { return i; }));
+    }
+    auto sum = clst::when_all(futures.begin(), futures.end()).then([](std::vector<long> v) {
+        long ret = 0;
+        for (std::size_t i = 0; i < v.size(); ++i) {
+            CLST_ASSERT_EQ(v[i], long(i)); // In order
+            ret += v[i];
+        }
+        return ret;
+    });
+    CLST_ASSERT_EQ(sum.get(), 4950L);
+
+    std::vector<clst::Future<void>> none;
+    CLST_EXPECT_NOTHROW(clst::when_all(none.begin(), none.end()).get());
+
+    std::vector<clst::Future<void>> voids;
+    voids.push_back(clst::async(pool, [] {}));
+    voids.push_back(clst::async(pool, [] { throw std::runtime_error("oops"); }));
+    CLST_EXPECT_THROW(clst::when_all(voids.begin(), voids.end()).get(), std::runtime_error);
+
+    // The only promise that gets fulfilled wins.
+    std::vector<clst::Promise<int>> promises(3);
+    std::vector<clst::Future<int>>  pending;
+    for (auto& p : promises) pending.push_back(p.get_future());
+    auto any = clst::when_any(pending.begin(), pending.end());
+    CLST_ASSERT(!any.is_ready());
+    promises[1].set_value(5);
+    const auto first = any.get();
+    CLST_ASSERT_EQ(first.index, std::size_t(1));
+    CLST_ASSERT_EQ(first.value, 5);
+}
+
+// get() on a worker helps instead of blocking it, so this doesn't deadlock on a single worker.
+long
+sum_to(Pool& pool, long n)
+{
+    if (n < 16) return n * (n + 1) / 2;
+    auto left = clst::async(pool, [&pool, n] { return sum_to(pool, n / 2); });
+    long right = 0;
+    for (long i = n / 2 + 1; i <= n; ++i) right += i;
+    return left.get() + right;
+}
+
+void
+test_stop_now()
+{
+    Pool pool(1);
+    std::promise<void> started, gate;
+    auto blocker = clst::async(pool, [&started, f = gate.get_future().share()] {
+        started.set_value();
+        f.wait();
+    });
+    started.get_future().wait();
+    auto dropped = clst::async(pool, [] { return 1; }).then([](int x) { return x; });
+    pool.stop_now();
+    gate.set_value();
+    CLST_EXPECT_NOTHROW(blocker.get());
+    CLST_EXPECT_THROW(dropped.get(), std::future_error);
+}
+
+// Threads exiting right after their wait() returns, while the worker that woke them may still be unparking them.
+void
+test_short_lived_waiters(Pool& pool)
+{
+    for (int i = 0; i < 200; ++i) {
+        auto fut = clst::async(pool, [i] { return i; });
+        std::thread([&fut, i] { CLST_ASSERT_EQ(fut.get(), i); }).join();
+    }
+}
+
+// Chained tasks: Continuations vs. a second task blocking on the std::future of the first one.
+void
+bench_chain(Pool& pool)
+{
+    static constexpr long n = 100000;
+    clst::Timer timer;
+    {
+        std::vector<clst::Future<long>> futures;
+        futures.reserve(n);
+        for (long i = 0; i < n; ++i) {
+            futures.push_back(clst::async(pool, [i] { return i; }).then([](long x) { return x + 1; }));
+        }
+        CLST_ASSERT_EQ(clst::when_all(futures.begin(), futures.end()).get().size(), std::size_t(n));
+    }
+    const auto t_future = timer.toc();
+    timer.tic();
+    {
+        std::vector<std::future<long>> futures;
+        futures.reserve(n);
+        for (long i = 0; i < n; ++i) {
+            auto first  = std::make_shared<std::promise<long>>();
+            auto second = std::make_shared<std::promise<long>>();
+            futures.push_back(second->get_future());
+            pool.enqueue([first, i] { first->set_value(i); });
+            pool.enqueue([f = first->get_future().share(), second] { second->set_value(f.get() + 1); });
+        }
+        for (auto& f : futures) f.get();
+    }
+    const auto t_std = timer.toc();
+    printf("100k chained tasks: clst::Future %.3fs, blocking std::future %.3fs\n", t_future, t_std);
+}
+
+} // namespace
+
+int future(int, char*[])
+{
+    Pool pool(2);
+    test_then(pool);
+    test_when(pool);
+    {
+        Pool single(1);
+        auto fut = clst::async(single, [&single] { return sum_to(single, 1000); });
+        CLST_ASSERT_EQ(fut.get(), 500500L);
+    }
+    test_stop_now();
+    test_short_lived_waiters(pool);
+    bench_chain(pool);
+
+    return 0;
+}
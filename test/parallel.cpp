@@ -0,0 +1,152 @@
+#include <clst/parallel.hpp>
+#include <clst/thread_pool.hpp>
+#include <clst/timer.hpp>
+#include "test_macros.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Pool = clst::ThreadPool<void, clst::WorkStealing, clst::InplaceTask<>>;
+
+template<typename P>
+void
+test_for(P& pool, clst::Partition part)
+{
+    std::vector<int> v(10007);
+    clst::parallel_for(pool, 0, static_cast<int>(v.size()), [&](int i) { v[i] += i; }, part);
+    for (int i = 0; i < static_cast<int>(v.size()); ++i) {
+        CLST_ASSERT_EQ(v[i], i); // Every index exactly once
+    }
+}
+
+template<typename P>
+void
+test_algorithms(P& pool, clst::Partition part)
+{
+    std::vector<long long> v(12345);
+    std::iota(v.begin(), v.end(), 1);
+
+    const auto sum = clst::parallel_reduce(pool, v.begin(), v.end(), 0LL, std::plus<>{}, part);
+    CLST_ASSERT_EQ(sum, 12345LL * 12346 / 2);
+
+    const auto sq = clst::parallel_transform_reduce(pool, v.begin(), v.end(), 0LL, std::plus<>{}, [](long long x) { return x * x; }, part);
+    CLST_ASSERT_EQ(sq, std::transform_reduce(v.begin(), v.end(), 0LL, std::plus<>{}, [](long long x) { return x * x; }));
+
+    std::vector<long long> out(v.size()), expected(v.size());
+    clst::parallel_transform(pool, v.begin(), v.end(), out.begin(), [](long long x) { return -x; }, part);
+    std::transform(v.begin(), v.end(), expected.begin(), [](long long x) { return -x; });
+    CLST_ASSERT(out == expected);
+
+    clst::parallel_scan(pool, v.begin(), v.end(), out.begin(), std::plus<>{}, part);
+    std::inclusive_scan(v.begin(), v.end(), expected.begin());
+    CLST_ASSERT(out == expected);
+
+    // Empty ranges
+    CLST_ASSERT_EQ(clst::parallel_reduce(pool, v.begin(), v.begin(), 7LL, std::plus<>{}, part), 7LL);
+}
+
+void
+test_exception(Pool& pool)
+{
+    std::atomic<int> count{0};
+    CLST_EXPECT_THROW(clst::parallel_for(pool, 0, 1000, [&](int i) {
+        count.fetch_add(1);
+        if (i == 500) throw std::runtime_error("oops");
+    }), std::runtime_error);
+    CLST_ASSERT(count.load() <= 1000);
+}
+
+template<typename P>
+void
+test_nested(P& pool)
+{
+    // Nested loops from inside pool tasks must not deadlock, even with every worker busy.
+    std::atomic<long> total{0};
+    clst::parallel_for(pool, 0, 16, [&](int) {
+        clst::parallel_for(pool, 0, 100, [&](int j) { total.fetch_add(j, std::memory_order_relaxed); });
+    }, {clst::Partition::Dynamic, 1});
+    CLST_ASSERT_EQ(total.load(), 16 * 4950L);
+}
+
+template<typename Serial, typename Parallel>
+void
+bench(const char* name, Serial&& serial, Parallel&& parallel)
+{
+    clst::Timer timer;
+    serial();
+    const auto t_serial = timer.toc();
+    timer.tic();
+    parallel();
+    const auto t_parallel = timer.toc();
+    printf("%s: serial %.4fs, parallel %.4fs\n", name, t_serial, t_parallel);
+}
+
+void
+benchmarks(Pool& pool)
+{
+    // Memory-bound: a[i] = a[i] + s * b[i]
+    static constexpr std::size_t n_mem = 1 << 22;
+    std::vector<float> a(n_mem, 1.0f), b(n_mem, 2.0f);
+    bench(
+        "axpy (memory-bound)",
+        [&] {
+            for (std::size_t i = 0; i < n_mem; ++i) a[i] += 0.5f * b[i];
+        },
+        [&] { clst::parallel_for(pool, std::size_t{0}, n_mem, [&](std::size_t i) { a[i] += 0.5f * b[i]; }, {clst::Partition::Static}); });
+    CLST_ASSERT_EQ(a[n_mem - 1], 3.0f);
+
+    // Compute-bound: a transcendental-heavy map-reduce
+    static constexpr std::size_t n_cpu = 1 << 18;
+    std::vector<double> x(n_cpu);
+    std::iota(x.begin(), x.end(), 0.0);
+    const auto kernel = [](double v) {
+        for (int k = 0; k < 8; ++k) v = std::sin(v) + std::sqrt(v + 1.0);
+        return v;
+    };
+    double r_serial = 0, r_parallel = 0;
+    bench(
+        "transform_reduce (compute-bound)",
+        [&] { r_serial = std::transform_reduce(x.begin(), x.end(), 0.0, std::plus<>{}, kernel); },
+        [&] { r_parallel = clst::parallel_transform_reduce(pool, x.begin(), x.end(), 0.0, std::plus<>{}, kernel, {clst::Partition::Guided, 256}); });
+    CLST_ASSERT(std::abs(r_serial - r_parallel) <= 1e-9 * std::abs(r_serial));
+}
+
+} // namespace
+
+int parallel(int, char*[])
+{
+    Pool pool(std::max(2u, std::thread::hardware_concurrency()));
+
+    for (auto kind : {clst::Partition::Static, clst::Partition::Dynamic, clst::Partition::Guided}) {
+        for (std::size_t grain : {1, 7, 1000, 100000}) {
+            test_for(pool, {kind, grain});
+            test_algorithms(pool, {kind, grain});
+        }
+    }
+    test_exception(pool);
+    test_nested(pool);
+    benchmarks(pool);
+
+    // Bounded queues: Callers run what they can't queue, rather than block with an outer chunk in hand.
+    {
+        clst::ThreadPool<void, clst::GlobalQueue, clst::InplaceTask<>> bounded(2, 1);
+        test_nested(bounded);
+        clst::ThreadPool<void, clst::BoundedQueue, clst::InplaceTask<>> ring(2, 2);
+        test_nested(ring);
+    }
+
+    // Also works on a default pool, and on a stopped one (everything runs on the caller).
+    clst::ThreadPool<> plain(2);
+    test_algorithms(plain, {});
+    plain.stop();
+    test_for(plain, {});
+
+    return 0;
+}
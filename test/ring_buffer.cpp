@@ -0,0 +1,29 @@
+#include <clst/ring_buffer.hpp>
+#include "test_macros.h"
+#include <memory>
+
+int ring_buffer(int, char*[])
+{
+    clst::RingBuffer<std::shared_ptr<int>> buf(3);
+    auto item = std::make_shared<int>(0);
+
+    // Wraps around.
+    for (int i = 0; i < 5; ++i) {
+        CLST_ASSERT(buf.push(item));
+        buf.pop();
+    }
+    for (int i = 0; i < 3; ++i) CLST_ASSERT(buf.push(item));
+    CLST_ASSERT(!buf.push(item));
+    buf.push_overwrite(std::make_shared<int>(1));
+    CLST_ASSERT_EQ(*buf.back(), 1);
+    CLST_ASSERT_EQ(item.use_count(), 3L);
+
+    // Destroys every item, across the wrap-around.
+    buf.clear();
+    CLST_ASSERT(buf.empty());
+    CLST_ASSERT_EQ(item.use_count(), 1L);
+    CLST_ASSERT(buf.push(item));
+    CLST_ASSERT_EQ(buf.front(), item);
+
+    return 0;
+}
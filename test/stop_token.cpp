@@ -0,0 +1,110 @@
+#include <clst/stop_token.hpp>
+#include <clst/channel.hpp>
+#include <clst/thread_pool.hpp>
+#include "test_macros.h"
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <optional>
+#include <thread>
+
+namespace {
+
+using namespace std::chrono_literals;
+
+void
+test_basics()
+{
+    clst::StopToken none;
+    CLST_ASSERT(!none.stop_possible());
+    CLST_ASSERT(!none.stop_requested());
+
+    clst::StopSource source;
+    auto token = source.get_token();
+    CLST_ASSERT(token.stop_possible());
+    CLST_ASSERT(token == source.get_token());
+
+    int count = 0;
+    {
+        clst::StopCallback removed(token, [&] { count += 100; });
+    }
+    clst::StopCallback cb(token, [&] { ++count; });
+    std::optional<clst::StopCallback<std::function<void()>>> self;
+    self.emplace(token, [&] { ++count; self.reset(); }); // Deregisters itself while running
+    CLST_ASSERT(source.request_stop());
+    CLST_ASSERT(!source.request_stop());
+    CLST_ASSERT(token.stop_requested());
+    CLST_ASSERT_EQ(count, 2);
+
+    // Already signalled: Runs right away.
+    clst::StopCallback late(token, [&] { ++count; });
+    CLST_ASSERT_EQ(count, 3);
+
+    // No source left to request a stop.
+    auto orphan = clst::StopSource().get_token();
+    CLST_ASSERT(!orphan.stop_possible());
+}
+
+void
+test_channel()
+{
+    clst::Channel<int, true, true, true> ch(1);
+    clst::StopSource source;
+    auto token = source.get_token();
+    CLST_ASSERT(ch.emplace(token, 1));
+
+    // Blocked on a full channel.
+    auto producer = std::async(std::launch::async, [&] { return ch.emplace(token, 2); });
+    CLST_ASSERT(producer.wait_for(20ms) == std::future_status::timeout);
+    source.request_stop();
+    CLST_ASSERT(!producer.get());
+    CLST_ASSERT(!ch.emplace(token, 3));
+
+    // A signalled token leaves items alone. Plain calls are not affected.
+    CLST_ASSERT(!ch.pop(token));
+    CLST_ASSERT_EQ(ch.pop(), std::optional<int>(1));
+
+    // Blocked on an empty channel.
+    clst::StopSource other;
+    auto consumer = std::async(std::launch::async, [&] { return ch.pop(other.get_token()); });
+    CLST_ASSERT(consumer.wait_for(20ms) == std::future_status::timeout);
+    other.request_stop();
+    CLST_ASSERT(!consumer.get());
+}
+
+void
+test_pool()
+{
+    clst::ThreadPool<void> pool(2);
+    clst::StopSource source;
+    std::atomic<long> iterations{0};
+    // Tasks poll the token, and give up early.
+    for (int i = 0; i < 2; ++i) {
+        pool.enqueue([&, token = source.get_token()] {
+            while (!token.stop_requested()) ++iterations;
+        });
+    }
+    clst::StopSource timeout;
+    auto waiter = std::async(std::launch::async, [&] { return pool.wait_all(timeout.get_token()); });
+    CLST_ASSERT(waiter.wait_for(20ms) == std::future_status::timeout);
+    timeout.request_stop();
+    CLST_ASSERT(!waiter.get());
+
+    source.request_stop();
+    CLST_ASSERT(pool.wait_all(clst::StopToken{}));
+    CLST_ASSERT(iterations.load() > 0);
+
+    std::promise<void> never;
+    CLST_ASSERT(!pool.wait(never.get_future(), source.get_token()));
+}
+
+} // namespace
+
+int stop_token(int, char*[])
+{
+    test_basics();
+    test_channel();
+    test_pool();
+    return 0;
+}
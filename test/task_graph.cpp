@@ -0,0 +1,100 @@
+#include <clst/task_graph.hpp>
+#include <clst/thread_pool.hpp>
+#include "test_macros.h"
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+using Pool = clst::ThreadPool<void, clst::WorkStealing, clst::InplaceTask<>>;
+
+void
+test_diamond_chain(Pool& pool)
+{
+    // a -> {b, c} -> d, repeated as a chain of diamonds.
+    static constexpr int nb_diamonds = 50;
+    std::vector<std::atomic<int>> stamps(nb_diamonds * 4);
+    std::atomic<int> clock{0};
+    clst::TaskGraph graph;
+
+    clst::TaskGraph::NodeId prev = 0;
+    for (int i = 0; i < nb_diamonds; ++i) {
+        auto node = [&, i](int k) { return graph.add([&, i, k] { stamps[i * 4 + k].store(clock.fetch_add(1)); }); };
+        const auto a = node(0), b = node(1), c = node(2), d = node(3);
+        graph.precede(a, b);
+        graph.precede(a, c);
+        graph.precede(b, d);
+        graph.precede(c, d);
+        if (i > 0) graph.precede(prev, a);
+        prev = d;
+    }
+
+    for (int run = 0; run < 20; ++run) { // Reusable
+        clock = 0;
+        graph.run(pool);
+        graph.wait();
+        CLST_ASSERT_EQ(clock.load(), nb_diamonds * 4);
+        for (int i = 0; i < nb_diamonds; ++i) {
+            const auto s = [&](int k) { return stamps[i * 4 + k].load(); };
+            CLST_ASSERT(s(0) < s(1) && s(0) < s(2));
+            CLST_ASSERT(s(1) < s(3) && s(2) < s(3));
+            if (i > 0) CLST_ASSERT(stamps[(i - 1) * 4 + 3].load() < s(0));
+        }
+    }
+}
+
+template<class P>
+void
+test_fan_out(P& pool)
+{
+    // One root, many independent leaves, one sink.
+    std::atomic<int> count{0};
+    clst::TaskGraph graph;
+    const auto root = graph.add([] {});
+    const auto sink = graph.add([&] { CLST_ASSERT_EQ(count.load(), 1000); });
+    for (int i = 0; i < 1000; ++i) {
+        const auto leaf = graph.add([&] { count.fetch_add(1); });
+        graph.precede(root, leaf);
+        graph.precede(leaf, sink);
+    }
+    graph.run(pool);
+    graph.wait();
+}
+
+void
+test_exception(Pool& pool)
+{
+    bool reached = false;
+    clst::TaskGraph graph;
+    const auto a = graph.add([] { throw std::runtime_error("a failed"); });
+    const auto b = graph.add([&] { reached = true; });
+    graph.precede(a, b);
+    graph.run(pool);
+    CLST_EXPECT_THROW(graph.wait(), std::runtime_error);
+    CLST_ASSERT(!reached);
+}
+
+} // namespace
+
+int task_graph(int, char*[])
+{
+    Pool pool(4);
+    test_diamond_chain(pool);
+    test_fan_out(pool);
+    test_exception(pool);
+
+    // Workers run the nodes they can't push to a full queue, instead of blocking on it.
+    {
+        clst::ThreadPool<void> bounded(1, 4);
+        test_fan_out(bounded);
+        clst::ThreadPool<void, clst::BoundedQueue> ring(2, 8);
+        test_fan_out(ring);
+    }
+
+    // A stopped pool runs the graph on the calling thread.
+    pool.stop();
+    test_fan_out(pool);
+
+    return 0;
+}
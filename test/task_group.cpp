@@ -0,0 +1,94 @@
+#include <clst/task_group.hpp>
+#include <clst/thread_pool.hpp>
+#include "test_macros.h"
+#include <atomic>
+#include <future>
+#include <stdexcept>
+
+namespace {
+
+using Pool = clst::ThreadPool<void, clst::WorkStealing, clst::InplaceTask<>>;
+
+void
+test_isolation(Pool& pool)
+{
+    // Group `slow` is stuck, `fast` must not wait for it.
+    std::promise<void> gate;
+    std::shared_future<void> gate_future = gate.get_future();
+    clst::TaskGroup slow(pool), fast(pool);
+    slow.run([gate_future] { gate_future.wait(); });
+    std::atomic<int> count{0};
+    for (int i = 0; i < 100; ++i) {
+        fast.run([&] { count.fetch_add(1); });
+    }
+    fast.wait();
+    CLST_ASSERT_EQ(count.load(), 100);
+    gate.set_value();
+    slow.wait();
+}
+
+void
+test_exception(Pool& pool)
+{
+    clst::TaskGroup group(pool);
+    group.run([] { throw std::runtime_error("first"); });
+    CLST_EXPECT_THROW(group.wait(), std::runtime_error);
+    // Reusable afterwards
+    bool ran = false;
+    group.run([&] { ran = true; });
+    CLST_EXPECT_NOTHROW(group.wait());
+    CLST_ASSERT(ran);
+}
+
+void
+test_cancel()
+{
+    Pool pool(1);
+    std::promise<void> started, gate;
+    clst::TaskGroup group(pool);
+    group.run([&started, f = gate.get_future().share()] {
+        started.set_value();
+        f.wait();
+    });
+    started.get_future().wait();
+    std::atomic<int> count{0};
+    for (int i = 0; i < 100; ++i) {
+        group.run([&] { count.fetch_add(1); });
+    }
+    group.cancel();
+    gate.set_value();
+    group.wait();
+    CLST_ASSERT_EQ(count.load(), 0); // All queued tasks skipped
+}
+
+long
+fib(Pool& pool, int n)
+{
+    if (n < 12) {
+        return n < 2 ? n : fib(pool, n - 1) + fib(pool, n - 2);
+    }
+    long left, right;
+    clst::TaskGroup group(pool);
+    group.run([&] { left = fib(pool, n - 1); });
+    right = fib(pool, n - 2);
+    group.wait(); // Helps instead of blocking the worker
+    return left + right;
+}
+
+} // namespace
+
+int task_group(int, char*[])
+{
+    Pool pool(2);
+    test_isolation(pool);
+    test_exception(pool);
+    test_cancel();
+
+    long result = 0;
+    clst::TaskGroup group(pool);
+    group.run([&] { result = fib(pool, 22); });
+    group.wait();
+    CLST_ASSERT_EQ(result, 17711L);
+
+    return 0;
+}
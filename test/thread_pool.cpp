@@ -0,0 +1,626 @@
+#include <clst/thread_pool.hpp>
+#include <clst/timer.hpp>
+#include <clst/sys_utils.hpp>
+#include "test_macros.h"
+#include <atomic>
+#include <vector>
+#include <future>
+#include <cstdio>
+#include <stdexcept>
+#include <chrono>
+#include <thread>
+#include <functional>
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+// Counts every allocation in the test program, see test_no_allocation().
+static std::atomic<long> nb_allocations{0};
+
+void*
+operator new(std::size_t size)
+{
+    nb_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void
+operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void
+operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+namespace {
+
+template<class Pool>
+void
+test_submit(std::size_t max_jobs)
+{
+    Pool pool(4, max_jobs);
+    std::vector<std::future<int>> futures;
+    for (int i = 0; i < 100; ++i) {
+        futures.push_back(pool.submit([i] { return i * i; }));
+    }
+    for (int i = 0; i < 100; ++i) {
+        CLST_ASSERT_EQ(futures[i].get(), i * i);
+    }
+}
+
+template<class Pool>
+void
+test_nested(std::size_t max_jobs)
+{
+    // Tasks spawning tasks, which end up in worker-local deques for WorkStealing.
+    // Workers blocking on a full queue could deadlock, so bounded queues must have room for everything.
+    Pool pool(4, max_jobs);
+    std::atomic<int> count{0};
+    for (int i = 0; i < 16; ++i) {
+        pool.enqueue([&] {
+            for (int j = 0; j < 64; ++j) {
+                pool.enqueue([&] { count.fetch_add(1, std::memory_order_relaxed); });
+            }
+        });
+    }
+    pool.wait_all();
+    CLST_ASSERT_EQ(count.load(), 16 * 64);
+}
+
+template<class Pool>
+void
+test_bulk(std::size_t max_jobs)
+{
+    Pool pool(4, max_jobs);
+    std::vector<std::function<int()>> fns;
+    for (int i = 0; i < 1000; ++i) {
+        fns.push_back([i] { return i * 2; });
+    }
+    auto futures = pool.submit_bulk(fns.begin(), fns.end());
+    CLST_ASSERT_EQ(futures.size(), fns.size());
+    for (int i = 0; i < 1000; ++i) {
+        CLST_ASSERT_EQ(futures[i].get(), i * 2);
+    }
+
+    std::atomic<int> count{0};
+    std::vector<std::function<int()>> incs(100, [&] { return count.fetch_add(1); });
+    if (!max_jobs) { // From inside a worker too, see test_nested()
+        pool.enqueue([&] {
+            pool.enqueue_bulk(incs.begin(), incs.end());
+            return 0;
+        });
+    }
+    pool.enqueue_bulk(incs.begin(), incs.end());
+    pool.wait_all();
+    CLST_ASSERT_EQ(count.load(), max_jobs ? 100 : 200);
+
+    pool.stop();
+    CLST_EXPECT_THROW(pool.enqueue_bulk(incs.begin(), incs.end()), typename Pool::EnqueueBlocked);
+    pool.wait_all();
+}
+
+template<class Pool>
+void
+test_stop(std::size_t max_jobs)
+{
+    Pool pool(2, max_jobs);
+    std::vector<std::future<void>> futures;
+    std::atomic<int> count{0};
+    for (int i = 0; i < 100; ++i) {
+        futures.push_back(pool.submit([&] { count.fetch_add(1); }));
+    }
+    pool.stop();
+    CLST_EXPECT_THROW(pool.enqueue([] {}), typename Pool::EnqueueBlocked);
+    pool.wait_all();
+    CLST_ASSERT_EQ(count.load(), 100); // Queued tasks still run after stop()
+    for (auto& f : futures) {
+        CLST_EXPECT_NOTHROW(f.get());
+    }
+}
+
+template<class Pool>
+void
+test_stop_now(std::size_t max_jobs)
+{
+    Pool pool(1, max_jobs);
+    std::promise<void> started, gate;
+    auto blocker = pool.submit([&started, f = gate.get_future()]() mutable {
+        started.set_value();
+        f.wait();
+    });
+    started.get_future().wait();
+    std::vector<std::future<void>> futures;
+    for (int i = 0; i < 10; ++i) {
+        futures.push_back(pool.submit([] {}));
+    }
+    pool.stop_now();
+    gate.set_value();
+    pool.wait_all();
+    blocker.get();
+    for (auto& f : futures) { // Discarded tasks break their promise
+        CLST_EXPECT_THROW(f.get(), std::future_error);
+    }
+    CLST_EXPECT_THROW(pool.enqueue([] {}), typename Pool::EnqueueBlocked);
+}
+
+template<class Pool>
+long
+fib(Pool& pool, int n)
+{
+    if (n < 12) {
+        return n < 2 ? n : fib(pool, n - 1) + fib(pool, n - 2);
+    }
+    auto left  = pool.submit([&pool, n] { return fib(pool, n - 1); });
+    auto right = fib(pool, n - 2);
+    pool.wait(left); // Blocking on left.get() could exhaust the workers
+    return left.get() + right;
+}
+
+template<class Pool>
+void
+test_fork_join()
+{
+    Pool pool(2, 1024);
+    auto f = pool.submit([&] { return fib(pool, 22); });
+    pool.wait(f); // Also works from outside the pool
+    CLST_ASSERT_EQ(f.get(), 17711L);
+}
+
+// Fan-out from inside workers: Every root task spawns many tiny tasks.
+template<class Pool>
+double
+bench_fan_out(std::size_t nb_threads)
+{
+    static constexpr int nb_children = 2000;
+    Pool pool(nb_threads);
+    std::atomic<int> sink{0};
+    clst::Timer timer;
+    for (std::size_t i = 0; i < nb_threads * 4; ++i) {
+        pool.enqueue([&] {
+            for (int j = 0; j < nb_children; ++j) {
+                pool.enqueue([&] { sink.fetch_add(1, std::memory_order_relaxed); });
+            }
+        });
+    }
+    pool.wait_all();
+    const auto t = timer.toc();
+    CLST_ASSERT_EQ(sink.load(), static_cast<int>(nb_threads * 4 * nb_children));
+    return t;
+}
+
+template<class Pool>
+void
+test_exceptions(std::size_t max_jobs)
+{
+    Pool pool(2, max_jobs);
+    auto f = pool.submit([]() -> int { throw std::runtime_error("task failed"); });
+    CLST_EXPECT_THROW(f.get(), std::runtime_error);
+    pool.enqueue([]() -> int { throw std::runtime_error("nobody listens"); }); // Must not take down the worker
+    CLST_ASSERT_EQ(pool.submit([] { return 42; }).get(), 42);
+}
+
+template<class Pool>
+void
+test_backpressure()
+{
+    // A full queue blocks producers, until a slot is freed or the pool is stopped.
+    Pool pool(1, 4);
+    std::promise<void> started, gate;
+    pool.enqueue([&started, f = gate.get_future()]() mutable {
+        started.set_value();
+        f.wait();
+    });
+    started.get_future().wait();
+    std::atomic<int> nb_queued{0};
+    std::thread producer([&] {
+        try {
+            for (;;) {
+                pool.enqueue([] {});
+                nb_queued.fetch_add(1);
+            }
+        } catch (const typename Pool::EnqueueBlocked&) {
+        }
+    });
+    while (nb_queued.load() < 4) std::this_thread::yield();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    CLST_ASSERT_EQ(nb_queued.load(), 4);
+    pool.stop();
+    producer.join();
+    gate.set_value();
+    pool.wait_all();
+}
+
+template<class Pool>
+void
+test_elastic()
+{
+    clst::ThreadPoolOptions opts;
+    opts.min_threads  = 1;
+    opts.max_threads  = 4;
+    opts.idle_timeout = std::chrono::milliseconds(20);
+    std::atomic<int> nb_init{0};
+    Pool pool([&] { nb_init.fetch_add(1); }, opts);
+    CLST_ASSERT_EQ(pool.size(), 1u);
+
+    // Blocked tasks pile up, so the pool grows up to max_threads.
+    const auto block_all = [&] {
+        std::promise<void> gate;
+        std::shared_future<void> g = gate.get_future().share();
+        std::atomic<int> nb_started{0};
+        for (int i = 0; i < 4; ++i) {
+            pool.enqueue([&nb_started, g] {
+                nb_started.fetch_add(1);
+                g.wait();
+            });
+        }
+        while (nb_started.load() < 4) std::this_thread::yield();
+        CLST_ASSERT_EQ(pool.size(), 4u);
+        gate.set_value();
+        pool.wait_all();
+    };
+    block_all();
+    CLST_ASSERT_EQ(nb_init.load(), 4);
+
+    // Idle workers retire, down to min_threads.
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (pool.size() > 1 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    CLST_ASSERT_EQ(pool.size(), 1u);
+
+    // And new ones are spawned in their slots.
+    block_all();
+    CLST_ASSERT_EQ(nb_init.load(), 7);
+}
+
+// With a single worker, the dequeue order is deterministic.
+template<std::size_t MaxSkips>
+void
+test_priorities(const std::vector<std::size_t>& levels, const std::vector<std::size_t>& expected)
+{
+    clst::ThreadPool<void, clst::PriorityQueue<3, MaxSkips>, clst::InplaceTask<>> pool(1);
+    std::promise<void> started, gate;
+    pool.enqueue([&started, f = gate.get_future()]() mutable {
+        started.set_value();
+        f.wait();
+    });
+    started.get_future().wait();
+    std::vector<std::size_t> order;
+    for (auto level : levels) {
+        pool.enqueue(clst::Priority{level}, [&order, level] { order.push_back(level); });
+    }
+    gate.set_value();
+    pool.wait_all();
+    CLST_ASSERT(order == expected);
+}
+
+// Latency of high priority tasks, under a flood of low priority ones. Returns the p99 in microseconds.
+template<class Pool>
+double
+bench_priority_p99(std::size_t nb_threads)
+{
+    static constexpr int nb_flood = 5000;
+    static constexpr int nb_probes = 200;
+    Pool pool(nb_threads);
+    const auto busy = [] {
+        const auto end = std::chrono::steady_clock::now() + std::chrono::microseconds(10);
+        while (std::chrono::steady_clock::now() < end) {}
+    };
+    std::vector<double> latencies(nb_probes);
+    std::vector<std::future<void>> probes;
+    for (int i = 0; i < nb_flood; ++i) {
+        if constexpr (clst::detail::is_priority_scheduler<typename Pool::SchedulerType>) {
+            pool.enqueue(clst::Priority{2}, busy);
+        } else {
+            pool.enqueue(busy);
+        }
+        if (i % (nb_flood / nb_probes) == 0) {
+            const auto t0   = std::chrono::steady_clock::now();
+            const auto probe = [&latencies, t0, j = probes.size()] {
+                latencies[j] = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+            };
+            if constexpr (clst::detail::is_priority_scheduler<typename Pool::SchedulerType>) {
+                probes.push_back(pool.submit(clst::Priority{0}, probe));
+            } else {
+                probes.push_back(pool.submit(probe));
+            }
+        }
+    }
+    pool.wait_all();
+    std::sort(latencies.begin(), latencies.end());
+    return latencies[nb_probes * 99 / 100];
+}
+
+void
+test_placement()
+{
+    using Pool = clst::ThreadPool<int>;
+    const auto topology = clst::get_cpu_topology();
+    CLST_ASSERT(!topology.empty());
+    CLST_ASSERT_EQ(Pool::current_worker_cpu(), -1);
+
+    const auto worker_cpus = [](clst::ThreadPoolOptions::Placement placement, std::size_t nb_threads) {
+        clst::ThreadPoolOptions opts;
+        opts.min_threads = opts.max_threads = nb_threads;
+        opts.placement   = std::move(placement);
+        Pool pool(opts);
+        std::vector<std::future<int>> futures;
+        for (std::size_t i = 0; i < nb_threads * 4; ++i) {
+            futures.push_back(pool.submit([] { return Pool::current_worker_cpu(); }));
+        }
+        std::vector<int> ret;
+        for (auto& f : futures) ret.push_back(f.get());
+        return ret;
+    };
+
+    const auto cpu = topology.back().id;
+    for (auto c : worker_cpus({clst::ThreadPoolOptions::Placement::Explicit, {cpu}}, 2)) {
+        CLST_ASSERT_EQ(c, static_cast<int>(cpu));
+    }
+    for (auto kind : {clst::ThreadPoolOptions::Placement::Compact, clst::ThreadPoolOptions::Placement::Scatter}) {
+        for (auto c : worker_cpus({kind, {}}, 2)) {
+            CLST_ASSERT(std::any_of(topology.begin(), topology.end(), [c](const clst::CpuInfo& info) { return static_cast<int>(info.id) == c; }));
+        }
+    }
+    for (auto c : worker_cpus({}, 2)) {
+        CLST_ASSERT_EQ(c, -1);
+    }
+}
+
+void
+test_scratch()
+{
+    using Pool = clst::ThreadPool<std::ptrdiff_t, clst::GlobalQueue, clst::InplaceTask<>>;
+    CLST_ASSERT_EQ(Pool::current_worker_index(), Pool::no_worker);
+    CLST_ASSERT(Pool::current_scratch() == nullptr);
+
+    static constexpr std::ptrdiff_t size = 4096;
+    clst::ThreadPoolOptions opts;
+    opts.min_threads = opts.max_threads = 2;
+    opts.scratch_size = size;
+    Pool pool(opts);
+
+    // Every task starts with an empty arena.
+    std::vector<std::future<std::ptrdiff_t>> futures;
+    for (int i = 0; i < 100; ++i) {
+        futures.push_back(pool.submit([] {
+            CLST_ASSERT(Pool::current_worker_index() < 2);
+            auto* scratch = Pool::current_scratch();
+            const auto ret = scratch->capacity();
+            CLST_ASSERT(scratch->allocate(100, 8) != nullptr);
+            return ret;
+        }));
+    }
+    for (auto& f : futures) {
+        CLST_ASSERT_EQ(f.get(), size);
+    }
+
+    // Nested tasks, run while helping, don't free the scratch memory of the outer one.
+    auto outer = pool.submit([&pool] {
+        auto* scratch = Pool::current_scratch();
+        CLST_ASSERT(scratch->allocate(100, 1) != nullptr);
+        auto inner = pool.submit([] {
+            Pool::current_scratch()->allocate(1000, 1);
+            return Pool::current_scratch()->capacity();
+        });
+        pool.wait(inner);
+        inner.get();
+        return scratch->capacity();
+    });
+    CLST_ASSERT_EQ(outer.get(), size - 100);
+}
+
+template<class Pool>
+void
+test_targeted()
+{
+    static constexpr std::size_t nb_workers = 3;
+    {
+        Pool pool(nb_workers);
+        std::vector<std::future<void>> futures;
+        for (std::size_t i = 0; i < 300; ++i) {
+            const auto k = i % nb_workers;
+            futures.push_back(pool.submit_to(k, [k] { CLST_ASSERT_EQ(Pool::current_worker_index(), k); }));
+        }
+        for (auto& f : futures) f.get();
+
+        // Each shard is only touched by its own worker, so plain counters will do.
+        std::size_t counters[8]{};
+        for (int i = 0; i < 8000; ++i) {
+            pool.enqueue_keyed(i % 8, [&counters, k = i % 8] { ++counters[k]; });
+        }
+        pool.wait_all();
+        for (auto c : counters) {
+            CLST_ASSERT_EQ(c, 1000u);
+        }
+    }
+
+    // Targeted tasks are dropped by stop_now(), like the rest.
+    Pool pool(1);
+    std::atomic<int> nb_run{0};
+    std::promise<void> gate;
+    pool.enqueue_to(0, [f = gate.get_future().share()] { f.wait(); });
+    for (int i = 0; i < 10; ++i) {
+        pool.enqueue_to(0, [&] { ++nb_run; });
+    }
+    pool.stop_now();
+    gate.set_value();
+    pool.wait_all();
+    CLST_ASSERT_EQ(nb_run.load(), 0);
+    CLST_EXPECT_THROW(pool.enqueue_to(0, [] {}), typename Pool::EnqueueBlocked);
+}
+
+template<class Scheduler>
+void
+test_stats()
+{
+    using Pool = clst::ThreadPool<void, Scheduler, clst::InplaceTask<>, clst::BlockingWait, true>;
+    static_assert(Pool::has_stats && !clst::ThreadPool<void, Scheduler>::has_stats);
+    Pool pool(2);
+    std::atomic<int> count{0};
+    for (int i = 0; i < 10; ++i) {
+        pool.enqueue([&] {
+            for (int j = 0; j < 99; ++j) {
+                pool.enqueue([&] { count.fetch_add(1); });
+            }
+        });
+    }
+    pool.wait_all();
+    pool.enqueue([] { std::this_thread::sleep_for(std::chrono::milliseconds(2)); });
+    pool.wait_all();
+
+    const auto stats = pool.stats();
+    CLST_ASSERT_EQ(stats.workers.size(), pool.size() + 1);
+    CLST_ASSERT_EQ(stats.queued, 0u);
+    CLST_ASSERT_EQ(stats.running, 0u);
+    const auto total = stats.total();
+    CLST_ASSERT_EQ(total.executed, 10u * 100 + 1);
+    CLST_ASSERT_EQ(total.queue_wait.count(), total.executed);
+    CLST_ASSERT_EQ(total.run_time.count(), total.executed);
+    CLST_ASSERT(total.run_time.quantile(1.0) >= std::chrono::milliseconds(2));
+    CLST_ASSERT(total.run_time.quantile(0.5) < std::chrono::milliseconds(2));
+    if (!std::is_same_v<Scheduler, clst::WorkStealing>) {
+        CLST_ASSERT_EQ(total.steals, 0u);
+    }
+    printf("stats: %llu tasks, %llu steals, %llu parks, p50 wait %lldns, p99 wait %lldns\n", (unsigned long long)total.executed,
+           (unsigned long long)total.steals, (unsigned long long)total.parks, (long long)total.queue_wait.quantile(0.5).count(),
+           (long long)total.queue_wait.quantile(0.99).count());
+}
+
+// Many tiny tasks from outside the pool, one by one or in a single batch.
+template<class Pool>
+double
+bench_bulk(std::size_t nb_threads, bool bulk)
+{
+    static constexpr int nb_tasks = 100000;
+    Pool pool(nb_threads);
+    std::atomic<int> sink{0};
+    std::vector<std::function<void()>> fns(nb_tasks, [&] { sink.fetch_add(1, std::memory_order_relaxed); });
+    clst::Timer timer;
+    if (bulk) {
+        pool.enqueue_bulk(fns.begin(), fns.end());
+    } else {
+        for (auto& f : fns) pool.enqueue(f);
+    }
+    pool.wait_all();
+    const auto t = timer.toc();
+    CLST_ASSERT_EQ(sink.load(), nb_tasks);
+    return t;
+}
+
+// Average round trip of a submit() to an idle worker, in microseconds.
+template<class Pool>
+double
+bench_latency()
+{
+    static constexpr int nb_rounds = 2000;
+    Pool pool(1);
+    clst::Timer timer;
+    for (int i = 0; i < nb_rounds; ++i) {
+        CLST_ASSERT_EQ(pool.submit([i] { return i; }).get(), i);
+    }
+    return timer.toc() / nb_rounds * 1e6;
+}
+
+// Small lambdas enqueued from outside, once the queue has grown to the size of the batch, don't touch the heap.
+template<class Pool>
+void
+test_no_allocation()
+{
+    static constexpr int nb_tasks = 1000;
+    Pool pool(1, nb_tasks); // Room for the whole batch, for BoundedQueue
+    std::atomic<bool> started{false}, release{false};
+    std::atomic<int>  count{0};
+    const auto task = [&count] { count.fetch_add(1, std::memory_order_relaxed); };
+
+    // Warm up with the worker held back, so that the whole batch queues up.
+    pool.enqueue([&] {
+        started = true;
+        while (!release) std::this_thread::yield();
+    });
+    while (!started) std::this_thread::yield();
+    for (int i = 0; i < nb_tasks; ++i) pool.enqueue(task);
+    release = true;
+    pool.wait_all();
+
+    const auto before = nb_allocations.load();
+    for (int i = 0; i < nb_tasks; ++i) pool.enqueue(task);
+    pool.wait_all();
+    CLST_ASSERT_EQ(nb_allocations.load() - before, 0L);
+    CLST_ASSERT_EQ(count.load(), 2 * nb_tasks);
+}
+
+template<class Scheduler, class Storage, class WaitPolicy = clst::BlockingWait>
+void
+test_all()
+{
+    // A small BoundedQueue, so that producers block.
+    const std::size_t max_jobs = std::is_same_v<Scheduler, clst::BoundedQueue> ? 16 : 0;
+    test_submit<clst::ThreadPool<int, Scheduler, Storage, WaitPolicy>>(max_jobs);
+    test_exceptions<clst::ThreadPool<int, Scheduler, Storage, WaitPolicy>>(max_jobs);
+    test_bulk<clst::ThreadPool<int, Scheduler, Storage, WaitPolicy>>(max_jobs);
+    test_nested<clst::ThreadPool<void, Scheduler, Storage, WaitPolicy>>(max_jobs ? 2048 : 0);
+    test_stop<clst::ThreadPool<void, Scheduler, Storage, WaitPolicy>>(max_jobs);
+    test_stop_now<clst::ThreadPool<void, Scheduler, Storage, WaitPolicy>>(max_jobs);
+}
+
+} // namespace
+
+int thread_pool(int, char*[])
+{
+    test_all<clst::GlobalQueue, clst::PackagedTask>();
+    test_all<clst::WorkStealing, clst::PackagedTask>();
+    test_all<clst::GlobalQueue, clst::InplaceTask<>>();
+    test_all<clst::WorkStealing, clst::InplaceTask<>>();
+    test_all<clst::BoundedQueue, clst::PackagedTask>();
+    test_all<clst::BoundedQueue, clst::InplaceTask<>>();
+    test_all<clst::PriorityQueue<>, clst::PackagedTask>();
+    test_all<clst::WorkStealing, clst::InplaceTask<>, clst::SpinWait<>>();
+    test_all<clst::BoundedQueue, clst::InplaceTask<>, clst::SpinWait<>>();
+    test_submit<clst::ThreadPool<int, clst::BoundedQueue>>(0); // Default capacity
+    test_fork_join<clst::ThreadPool<long>>();
+    test_fork_join<clst::ThreadPool<long, clst::WorkStealing, clst::InplaceTask<>>>();
+    test_fork_join<clst::ThreadPool<long, clst::BoundedQueue>>();
+    test_backpressure<clst::ThreadPool<void>>();
+    test_backpressure<clst::ThreadPool<void, clst::BoundedQueue>>();
+    test_priorities<clst::no_aging>({2, 1, 0, 2, 1, 0}, {0, 0, 1, 1, 2, 2});
+    test_priorities<1>({2, 2, 2, 0, 0, 0}, {0, 2, 0, 2, 0, 2});
+    test_priorities<2>({1, 1, 0, 0, 0, 0}, {0, 0, 1, 0, 0, 1});
+    test_placement();
+    test_scratch();
+    test_targeted<clst::ThreadPool<void>>();
+    test_targeted<clst::ThreadPool<void, clst::WorkStealing, clst::InplaceTask<>>>();
+    test_stats<clst::GlobalQueue>();
+    test_stats<clst::WorkStealing>();
+    test_elastic<clst::ThreadPool<void>>();
+    test_elastic<clst::ThreadPool<void, clst::WorkStealing, clst::InplaceTask<>, clst::SpinWait<>>>();
+
+    test_no_allocation<clst::ThreadPool<void, clst::GlobalQueue, clst::InplaceTask<>>>();
+    test_no_allocation<clst::ThreadPool<void, clst::PriorityQueue<>, clst::InplaceTask<>>>();
+    test_no_allocation<clst::ThreadPool<void, clst::WorkStealing, clst::InplaceTask<>>>();
+    test_no_allocation<clst::ThreadPool<void, clst::BoundedQueue, clst::InplaceTask<>>>();
+
+    const auto nb_threads = std::max(2u, std::thread::hardware_concurrency());
+    const auto t_global   = bench_fan_out<clst::ThreadPool<void>>(nb_threads);
+    const auto t_stealing = bench_fan_out<clst::ThreadPool<void, clst::WorkStealing>>(nb_threads);
+    printf("fan-out with %u threads: GlobalQueue %.3fs, WorkStealing %.3fs\n", nb_threads, t_global, t_stealing);
+
+    const auto t_single = bench_bulk<clst::ThreadPool<void, clst::GlobalQueue, clst::InplaceTask<>>>(nb_threads, false);
+    const auto t_bulk   = bench_bulk<clst::ThreadPool<void, clst::GlobalQueue, clst::InplaceTask<>>>(nb_threads, true);
+    printf("100k tiny tasks: enqueue %.3fs, enqueue_bulk %.3fs\n", t_single, t_bulk);
+
+    const auto p99_fifo     = bench_priority_p99<clst::ThreadPool<void, clst::GlobalQueue, clst::InplaceTask<>>>(nb_threads);
+    const auto p99_priority = bench_priority_p99<clst::ThreadPool<void, clst::PriorityQueue<>, clst::InplaceTask<>>>(nb_threads);
+    printf("p99 latency under a flood: GlobalQueue %.0fus, PriorityQueue %.0fus\n", p99_fifo, p99_priority);
+
+    const auto lat_blocking = bench_latency<clst::ThreadPool<int, clst::GlobalQueue, clst::InplaceTask<>>>();
+    const auto lat_spinning = bench_latency<clst::ThreadPool<int, clst::GlobalQueue, clst::InplaceTask<>, clst::SpinWait<>>>();
+    printf("submit round trip: BlockingWait %.2fus, SpinWait %.2fus\n", lat_blocking, lat_spinning);
+
+    return 0;
+}
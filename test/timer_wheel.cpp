@@ -0,0 +1,111 @@
+#include <clst/timer_wheel.hpp>
+#include <clst/thread_pool.hpp>
+#include <clst/timer.hpp>
+#include "test_macros.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <future>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Pool  = clst::ThreadPool<void, clst::GlobalQueue, clst::InplaceTask<>>;
+using Wheel = clst::TimerWheel<Pool>;
+using namespace std::chrono_literals;
+
+void
+test_one_shot(Pool& pool)
+{
+    Wheel wheel(pool);
+    const auto start = Wheel::ClockType::now();
+    std::promise<Wheel::ClockType::time_point> fired;
+    wheel.schedule_after(20ms, [&] { fired.set_value(Wheel::ClockType::now()); });
+    const auto at = fired.get_future().get();
+    CLST_ASSERT(at - start >= 20ms);
+    CLST_ASSERT(at - start < 1s);
+    CLST_ASSERT_EQ(wheel.size(), std::size_t(0));
+
+    // Cancelled timers don't fire, and handles of fired or cancelled timers are inert, even once their node is reused.
+    std::atomic<int> count{0};
+    auto cancelled = wheel.schedule_after(10ms, [&] { count += 100; });
+    CLST_ASSERT(wheel.cancel(cancelled));
+    CLST_ASSERT(!wheel.cancel(cancelled));
+    std::promise<void> done;
+    auto reused = wheel.schedule_after(30ms, [&] { ++count; done.set_value(); });
+    CLST_ASSERT_EQ(reused.index, cancelled.index);
+    CLST_ASSERT(!wheel.cancel(cancelled));
+    done.get_future().wait();
+    CLST_ASSERT_EQ(count.load(), 1);
+    CLST_ASSERT(!wheel.cancel(reused));
+
+    // Due timers fire right away.
+    std::promise<void> late;
+    wheel.schedule_at(start, [&] { late.set_value(); });
+    CLST_ASSERT(late.get_future().wait_for(1s) == std::future_status::ready);
+}
+
+void
+test_periodic(Pool& pool)
+{
+    Wheel wheel(pool);
+    std::atomic<int> count{0};
+    auto h = wheel.schedule_every(5ms, [&] { ++count; });
+    std::this_thread::sleep_for(100ms);
+    CLST_ASSERT(wheel.cancel(h));
+    pool.wait_all();
+    const auto n = count.load();
+    CLST_ASSERT(n >= 5 && n <= 21);
+    std::this_thread::sleep_for(20ms);
+    CLST_ASSERT_EQ(count.load(), n);
+}
+
+// Far-out timers cascade down the levels. Use a coarse tick, so that this crosses levels quickly.
+void
+test_cascade(Pool& pool)
+{
+    Wheel wheel(pool, 10us);
+    std::atomic<int> count{0};
+    std::promise<void> done;
+    static constexpr int n = 200;
+    for (int i = 1; i <= n; ++i) {
+        // Up to 100000 ticks ahead: levels 0 to 2.
+        wheel.schedule_after(std::chrono::microseconds(i * 5000), [&] {
+            if (++count == n) done.set_value();
+        });
+    }
+    CLST_ASSERT(done.get_future().wait_for(5s) == std::future_status::ready);
+    CLST_ASSERT_EQ(wheel.size(), std::size_t(0));
+}
+
+// Many pending timers: Scheduling and cancelling stay cheap, and an idle wheel costs nothing.
+void
+bench_many_timers(Pool& pool)
+{
+    static constexpr std::size_t n = 1000000;
+    Wheel wheel(pool);
+    std::vector<Wheel::Handle> handles;
+    handles.reserve(n);
+    clst::Timer timer;
+    for (std::size_t i = 0; i < n; ++i) {
+        handles.push_back(wheel.schedule_after(std::chrono::seconds(60) + std::chrono::microseconds(i), [] {}));
+    }
+    const auto t_schedule = timer.toc();
+    timer.tic();
+    for (auto h : handles) CLST_ASSERT(wheel.cancel(h));
+    const auto t_cancel = timer.toc();
+    printf("1M timers: schedule %.0fns, cancel %.0fns per timer\n", t_schedule / n * 1e9, t_cancel / n * 1e9);
+}
+
+} // namespace
+
+int timer_wheel(int, char*[])
+{
+    Pool pool(2);
+    test_one_shot(pool);
+    test_periodic(pool);
+    test_cascade(pool);
+    bench_many_timers(pool);
+    return 0;
+}